@@ -0,0 +1,126 @@
+#include "util.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+// Math benchmarks: time the hand-vectorized matrix code against the generic templates.
+
+namespace
+{
+	using namespace util;
+
+	const int NumItems = 1024;
+	const int NumIterations = 2000;
+
+	// Time a transform of an array of items.  Each pass transforms the previous pass's output,
+	// so repeated passes can't be optimized away.
+	template <typename T, typename Func>
+	double timeNsPerOp(T (&buffers)[2][NumItems], Func func)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		for (int iter = 0; iter < NumIterations; ++iter)
+		{
+			const T * pIn = buffers[iter & 1];
+			T * pOut = buffers[(iter + 1) & 1];
+			for (int i = 0; i < NumItems; ++i)
+				pOut[i] = func(pIn[i]);
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		double ns = double(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+		return ns / (double(NumIterations) * NumItems);
+	}
+
+	// Count the items where the generic and SIMD versions disagree, by more than a tolerance
+	// relative to the size of the result
+	template <typename T, typename FuncGeneric, typename FuncSIMD>
+	int countMismatches(const T * pItems, FuncGeneric funcGeneric, FuncSIMD funcSIMD)
+	{
+		int mismatches = 0;
+		for (int i = 0; i < NumItems; ++i)
+		{
+			auto expected = funcGeneric(pItems[i]);
+			auto actual = funcSIMD(pItems[i]);
+			float tolerance = 1e-4f * max(1.0f, maxComponent(abs(expected)));
+			if (!all(isnear(expected, actual, tolerance)))
+				++mismatches;
+		}
+		return mismatches;
+	}
+
+	// Check the SIMD version's results against the generic one, then time both.  The items are
+	// restored after each timing, so both versions (and later benchmarks) start from the
+	// original inputs; many passes of some ops, e.g. multiplying by an affine transform, drift
+	// toward badly conditioned matrices.
+	template <typename T, typename FuncGeneric, typename FuncSIMD>
+	void bench(const char * name, T (&buffers)[2][NumItems], FuncGeneric funcGeneric, FuncSIMD funcSIMD)
+	{
+		static T s_saved[NumItems];
+		memcpy(s_saved, buffers[0], sizeof(s_saved));
+		int mismatches = countMismatches(buffers[0], funcGeneric, funcSIMD);
+		double nsGeneric = timeNsPerOp(buffers, funcGeneric);
+		memcpy(buffers[0], s_saved, sizeof(s_saved));
+		double nsSIMD = timeNsPerOp(buffers, funcSIMD);
+		memcpy(buffers[0], s_saved, sizeof(s_saved));
+		printf("%-26s generic %6.2f ns, SIMD %6.2f ns, speedup %.2fx", name, nsGeneric, nsSIMD, nsGeneric / nsSIMD);
+		if (mismatches)
+			printf(" -- %d of %d results MISMATCHED\n", mismatches, NumItems);
+		else
+			printf("\n");
+	}
+
+	float4x4 s_matrices[2][NumItems];
+	float3x4 s_matrices3x4[2][NumItems];
+	float4 s_vectors[2][NumItems];
+	float3 s_points[2][NumItems];
+	affine3 s_transforms[2][NumItems];
+}
+
+void BenchMath()
+{
+	using namespace util;
+
+	RNG rng(47);
+	for (int i = 0; i < NumItems; ++i)
+	{
+		// Diagonally dominant, so the inverses are well-conditioned enough to compare
+		for (int j = 0; j < 16; ++j)
+			s_matrices[0][i].data[j] = rng.randFloat(-1.0f, 1.0f);
+		s_matrices[0][i] += float4x4(identity) * 4.0f;
+		s_matrices3x4[0][i] = float3x4(s_matrices[0][i]);
+		s_vectors[0][i] = { rng.randFloat(), rng.randFloat(), rng.randFloat(), rng.randFloat() };
+		s_points[0][i] = { rng.randFloat(), rng.randFloat(), rng.randFloat() };
+		s_transforms[0][i] = affineMatrix(rotationMatrixAxisAngle3D(s_points[0][i], rng.randFloat(0.0f, 6.0f)), s_vectors[0][i].xyz);
+	}
+
+	// Use a rigid transform, so the values stay bounded over many passes
+	affine3 b = affineMatrix(rotationMatrixAxisAngle3D(float3(1.0f, 2.0f, 3.0f), 0.5f), float3(0.1f, 0.2f, 0.3f));
+
+	bench("float4x4 * float4x4", s_matrices,
+		[&](float4x4 const & a) { return operator *<float, 4, 4, 4>(a, b); },
+		[&](float4x4 const & a) { return a * b; });
+
+	bench("float3x4 * float4x4", s_matrices3x4,
+		[&](float3x4 const & a) { return operator *<float, 3, 4, 4>(a, b); },
+		[&](float3x4 const & a) { return a * b; });
+
+	bench("float4 * float4x4", s_vectors,
+		[&](float4 a) { return operator *<float, 4, 4>(a, b); },
+		[&](float4 a) { return a * b; });
+
+	bench("xfmPoint(float3, affine3)", s_points,
+		[&](float3 a) { return xfmPoint<float, 4, 4>(a, b); },
+		[&](float3 a) { return xfmPoint(a, b); });
+
+	// Generic here is the Gaussian elimination for any n
+	bench("inverse(float4x4)", s_matrices,
+		[&](float4x4 const & a) { float4x4 result; tryInvertMatrix<float, 4>(a, &result); return result; },
+		[&](float4x4 const & a) { return inverse(a); });
+
+	bench("inverseAffine(affine3)", s_transforms,
+		[&](affine3 const & a) { return inverseAffine<float, 4>(a); },
+		[&](affine3 const & a) { return inverseAffine(a); });
+
+	bench("inverseRigid(affine3)", s_transforms,
+		[&](affine3 const & a) { return inverseRigid<float, 4>(a); },
+		[&](affine3 const & a) { return inverseRigid(a); });
+}
@@ -49,4 +49,99 @@ void TestContainers()
 	da5.removeSwap(1);
 	da5.clear();
 	da5.reset();
+
+	float3 float3_array[] = { { 1, 2, 3 }, { 4, 5, 6 }, { 7, 8, 9 }, { 10, 11, 12 }, { 13, 14, 15 } };
+	aosoa_array<float, 3> aa1;
+	aosoa_array<float, 3> aa2(100);
+	aosoa_array<float, 3, 8> aa3(float3_array);
+	aosoa_array<int, 4, 16> aa4;
+	aosoa_array<float, 3> aa5(aa1);
+	aosoa_array<float, 3> aa6 = std::move(aa5);
+	aa2 = aa6;
+	aa1.append(float3_array[0]);
+	aa1.appendSeveral(float3_array);
+	aa1.set(2, aa1.get(3));
+	aa1.component(4, 1) = 17.0f;
+	aa1.removeSwap(1);
+	aa1.resize(20);
+	float3_simd & chunk = aa1.chunk(0);
+	chunk += aa1.chunks()[1];
+	float3 float3_buffer[20];
+	aa1.copyTo(float3_buffer);
+	aa3.chunks()[0] * aa3.chunks()[0];
+	aosoa_array<float, 3, 8> const & aa3c = aa3;
+	aa3c.chunks()[0] + aa3c.chunk(0);
+	aa3c.get(aa3c.size - 1) * aa3c.component(0, 1);
+	aa3c.copyTo(float3_array);
+	aa4.append(int4(1, 2, 3, 4));
+	aa6.copyTo(array<float3>());
+	aa1.clear();
+	aa1.reset();
+
+	float float_array[dim(float3_array)];
+	dotBatch(float3_array, float3_array, float_array);
+	lengthBatch(float3_array, float_array);
+	float3 float3_out[dim(float3_array)];
+	xfmPointBatch(float3_array, affine3(identity), float3_out);
+	xfmVectorBatch(float3_array, float3x3(identity), float3_out, 4);
+	projectPointBatch(float3_array, perspProjD3DStyle(1.0f, 1.0f, 0.1f, 100.0f), float3_out);
+	xfmPointBatch(int(dim(float3_array)), float3_array, sizeof(float3), affine3(identity), float3_out, sizeof(float3));
+	quat quat_array[dim(float3_array)] = { quat(identity), quat(identity), quat(identity), quat(identity), quat(identity) };
+	applyQuatBatch(quat(identity), float3_array, float3_out);
+	applyQuatBatch(quat_array, float3_array, float3_out, 4);
+	float4x4 float4x4_array[5] = { float4x4(identity), float4x4(identity), float4x4(identity), float4x4(identity), float4x4(identity) };
+	bool bool_array[dim(float4x4_array)];
+	inverseBatch(float4x4_array, float4x4_array, bool_array);
+	determinantBatch(float4x4_array, array<float>(float_array, dim(float4x4_array)));
+	float3x3 float3x3_array[3] = { float3x3(identity), float3x3(identity), float3x3(identity) };
+	eigenDecomposeSymmetricBatch(float3x3_array, array<float3>(float3_out, dim(float3x3_array)), float3x3_array);
+
+	dmatrix<float> dm1;
+	dmatrix<float> dm2(10, 20);
+	dmatrix<float> dm3(1, 5, array<const float>(float_array, dim(float_array)));
+	dmatrix<float> dm4(float3x3_array[0]);
+	dmatrix<double> dm5(dm2.cols, dm2.cols);
+	dmatrix<float> dm6(dm3);
+	dmatrix<float> dm7 = std::move(dm6);
+	dm1 = dm7;
+	dm2(1, 2) = dm3(0, 1);
+	dm2.row(3)[4] = 47.0f;
+	dm5(0, 0) = 47.0;
+	float3x3 block = dm4.getBlock<3, 3>(0, 0);
+	dm2.setBlock(1, 1, block);
+	transpose(dm3, &dm1);
+	multiply(dm3, dm1, &dm6);
+	float dm_out[10];
+	multiply(dm2, dm2.row(0), array<float>(dm_out), 4);
+	dmatrix<double> dm8;
+	multiply(dm5, dm5, &dm8);
+	if (trySolve(dm4, dm4, &dm6))
+		trySolve(dm4, array<const float>(float_array, 3), array<float>(float_array, 3));
+	dm2.resize(4, 4);
+	dm2.setZero();
+	dm2.reset();
+
+	csrmatrix<float> csr1(3);
+	csr1.appendEntry(0, 2.0f);
+	csr1.endRow();
+	csr1.find(0, 0);
+	csrentry<float> csr_entries[] = { { 1, 1, 2.0f }, { 0, 0, 2.0f }, { 2, 2, 2.0f }, { 1, 1, 1.0f }, { 0, 1, -1.0f }, { 1, 0, -1.0f } };
+	buildCSRMatrix(3, 3, array<const csrentry<float>>(csr_entries), &csr1);
+	float csr_out[3] = {};
+	multiply(csr1, array<const float>(float_array, 3), array<float>(csr_out), 4);
+	trySolveConjugateGradient(csr1, array<const float>(float_array, 3), array<float>(csr_out));
+	csrmatrix<float3x3> csr2(dim(float3_array));
+	for (int i = 0; i < int(dim(float3_array)); ++i)
+	{
+		csr2.appendEntry(i, float3x3(identity));
+		csr2.endRow();
+	}
+	multiply(csr2, float3_array, float3_out);
+	trySolveConjugateGradient(csr2, array<const float3>(float3_array), array<float3>(float3_out), 1e-4f, 100, 0);
+	csrmatrix<double> csr3(1);
+	csr3.appendEntry(0, 1.0);
+	csr3.endRow();
+	double double_array[2] = { 1.0, 0.0 };
+	multiply(csr3, array<const double>(double_array, 1), array<double>(double_array + 1, 1));
+	csr3.clear(2);
 }
@@ -92,6 +92,8 @@ void testVectors()
 	maxComponent(foo5);
 	foo5 = lerp(foo5, foo5, 0.5f);
 	foo5 = square(foo5);
+	foo5 = fma(foo5, foo5, foo5);
+	foo5 = fma(foo5, 2.0f, foo5);
 
 	vector<int, 5> ifoo5 = { 1, 2, 3, 4, 5 };
 	(void) vector<float, 4>(ifoo5);
@@ -171,6 +173,11 @@ void testVectors()
 
 	float bazArray[] = { 1, 2, 3, 4 };
 	(void) float4(bazArray);
+
+	// Compile-time construction and arithmetic
+	constexpr float3 cfoo3 = cross(float3(1, 0, 0), float3(0, 1, 0)) * 2.0f - float3(1.0f);
+	constexpr float4 cfoo4(cfoo3, 1.0f);
+	cassert(dot(cfoo4, cfoo4) == 4.0f);
 }
 
 
@@ -231,11 +238,39 @@ void testMatrices()
 	foo5 * bar5;
 	bar5 * foo5;
 	bar5 *= foo5;
+	foo11 * foo11;
+	foo11 *= foo11;
+	foo4 * foo11;
+	foo9 * foo4;
+	float4(1.0f) * foo11;
+	float3(1.0f) * foo4;
+	xfmPoint(float3(1.0f), foo11);
+	xfmVector(float3(1.0f), foo11);
 	foo5 = transpose(foo5);
 	foo5 = pow(foo5, 5);
 	tryInvertMatrix(foo5, &foo5);
 	inverse(foo5);
 	determinant(foo5);
+	tryInvertMatrix(foo6, &foo6);
+	inverse(foo6);
+	determinant(foo6);
+	float3 eigenvalues;
+	eigenDecomposeSymmetric(foo6, &eigenvalues, &foo6);
+	decomposeSVD(foo6, &foo6, &eigenvalues, &foo6);
+	polarDecompose(foo6, &foo6, &foo6);
+	tryInvertMatrix(foo11, &foo11);
+	inverse(foo11);
+	determinant(foo11);
+	inverse(matrix<double, 4, 4>(identity));
+	luDecomposition<float, 5> lu5;
+	if (tryDecomposeLU(foo5, &lu5))
+	{
+		bar5 = lu5.solve(bar5);
+		foo10 = transpose(lu5.solve(transpose(foo10)));
+		lu5.determinant();
+		foo5 = lu5.inverse();
+	}
+	determinant(matrix<double, 4, 4>(identity));
 	trace(foo5);
 	foo5 = diagonalMatrix<float, 5>(47.0f);
 	foo5 = diagonalMatrix(bar5);
@@ -265,6 +300,8 @@ void testMatrices()
 	maxComponent(foo5);
 	foo5 = lerp(foo5, foo5, 0.5f);
 	foo5 = square(foo5);
+	foo5 = fma(foo5, foo5, foo5);
+	foo5 = fma(foo5, 2.0f, foo5);
 
 	matrix<int, 5, 5> ifoo5 = { 1, 2, 3, 4, 5 };
 	(void) matrix<float, 4, 4>(ifoo5);
@@ -346,6 +383,14 @@ void testMatrices()
 	tryInvertAffine(foo5, &foo5);
 	foo5 = inverseAffine(foo5);
 	foo5 = inverseRigid(foo5);
+	tryInvertAffine(foo11, &foo11);
+	foo11 = inverseAffine(foo11);
+	foo11 = inverseRigid(foo11);
+
+	// Compile-time construction and arithmetic
+	constexpr float3x4 cfoo3x4 = transpose(float4x3(diagonalMatrix(1.0f, 2.0f, 3.0f))) * 2.0f;
+	constexpr float3x3 cfoo3x3 = float3x3(cfoo3x4) - float3x3(identity);
+	cassert(cfoo3x3.data[4] == 3.0f && cfoo3x4.data[3] == 0.0f);
 }
 
 
@@ -357,10 +402,145 @@ void testSIMD()
 	__m128 simdA = { 1.0f, 2.0f, 3.0f, 4.0f, }, simdB = { 5.0f, 6.0f, 7.0f, 8.0f, };
 	simdA + simdB;
 	simdA += simdB;
+	fma(simdA, simdB, simdA);
+	fma(1.0f, 2.0f, 3.0f);
 
 	float3_simd simdVector;
 	simdVector + simdVector;
 	simdVector + _mm_set_ps(47, 48, 49, 50);
+	dot(simdVector, simdVector);
+	float4x4_simd simdMatrix;
+	simdMatrix * simdMatrix;
+	float3_simd simdExtent(splat<__m128>(1.0f));
+	any(any(abs(simdVector) > simdExtent));
+	all(simdA < simdB);
+	movemask(simdA < simdB);
+	select(simdA < simdB, simdA, simdB);
+	min(_mm_set1_epi32(1), _mm_set1_epi32(2));
+	clamp(simdVector, -simdExtent, simdExtent);
+	saturate(simdVector);
+	abs(simdMatrix);
+	tryInvertMatrix(simdMatrix, &simdMatrix);
+	float3x3_simd simdMatrix3;
+	eigenDecomposeSymmetric(simdMatrix3, &simdVector, &simdMatrix3, 5);
+	decomposeSVD(simdMatrix3, &simdMatrix3, &simdVector, &simdMatrix3);
+	polarDecompose(simdMatrix3, &simdMatrix3, &simdMatrix3);
+	saturate(simdMatrix);
+	divisor simdDivisor(17);
+	int3_simd simdIntVector;
+	simdIntVector / simdDivisor;
+	simdIntVector % simdDivisor;
+	47 / simdDivisor;
+
+	__m256 simd8A = _mm256_set1_ps(1.0f), simd8B = _mm256_set1_ps(2.0f);
+	simd8A + simd8B;
+	simd8A * 47.0f;
+	simd8A += simd8B;
+	simd8A < simd8B;
+	__m256i simd8IntA = _mm256_set1_epi32(1), simd8IntB = _mm256_set1_epi32(2);
+	simd8IntA * simd8IntB;
+	simd8IntA ^ 47;
+	simd8IntA >= simd8IntB;
+	simd8IntA / simdDivisor;
+	movemask(simd8IntA >= simd8IntB);
+	any(simd8A < simd8B);
+
+	float3_simd8 simd8Vector;
+	simd8Vector + simd8Vector;
+	simd8Vector * simd8A;
+	dot(simd8Vector, simd8Vector);
+	cross(simd8Vector, simd8Vector);
+	float4x4_simd8 simd8Matrix;
+	simd8Matrix * simd8Matrix;
+	float4_simd8 simd8Vector4;
+	simd8Vector4 * simd8Matrix;
+	simd8Matrix * simd8Vector4;
+	xfmPoint(simd8Vector, simd8Matrix);
+	xfmVector(simd8Vector, simd8Matrix);
+	transpose(simd8Matrix);
+	movemask(tryInvertMatrix(simd8Matrix, &simd8Matrix));
+	int3_simd8 simd8IntVector;
+	simd8IntVector * simd8IntVector;
+
+	__m512 simd16A = _mm512_set1_ps(1.0f), simd16B = _mm512_set1_ps(2.0f);
+	simd16A + simd16B;
+	simd16A * 2.0f;
+	__mmask16 simd16Mask = simd16A < simd16B;
+	any(simd16Mask);
+	all(simd16Mask);
+	movemask(simd16Mask);
+	select(simd16Mask, simd16A, simd16B);
+	min(simd16A, simd16B);
+	max(simd16A, simd16B);
+	float3_simd16 simd16Vector(simd16A);
+	dot(simd16Vector, simd16Vector);
+	select(simd16Vector < simd16Vector, simd16Vector, simd16Vector);
+	min(simd16Vector, simd16Vector);
+	max(simd16Vector, simd16B);
+	all(any(simd16Vector == simd16Vector));
+	float4x4_simd16 simd16Matrix;
+	simd16Matrix * simd16Matrix;
+	any(simd16Matrix != simd16Matrix);
+	any(tryInvertMatrix(simd16Matrix, &simd16Matrix));
+	int3_simd16 simd16IntVector;
+	simd16IntVector * simd16IntVector;
+	min(simd16IntVector, simd16IntVector);
+	simd16IntVector % simdDivisor;
+
+	sqrt(simdA);
+	rcp(simdA);
+	rsqrt(simdA);
+	exp(simdA);
+	exp2(simdA);
+	log(simdA);
+	log2(simdA);
+	pow(simdA, simdB);
+	pow(simdA, 2.2f);
+	sin(simdA);
+	cos(simdA);
+	__m128 simdSin, simdCos;
+	sincos(simdA, &simdSin, &simdCos);
+	acos(simdA);
+	atan2(simdA, simdB);
+	length(simdVector);
+	normalize(simdVector);
+	pow(simdVector, 2.2f);
+	normalize(simd8Vector);
+	pow(simd8Vector, 1.0f / 2.2f);
+	atan2(simd8Vector[0], simd8Vector[1]);
+	normalize(simd16Vector);
+	sincos(simd16A, &simd16A, &simd16B);
+
+	ISA isa = detectISA();
+	nameOfISA(isa);
+	forceISA(ISA_SSE2);
+	currentISA();
+	forceISA(ISA_Count);
+
+	float3 aosVectors[10] = {};
+	__declspec(align(32)) float aosoaVectors[3 * 16];
+	convertToAOSOA(3, dim(aosVectors), aosVectors, sizeof(float3), aosoaVectors, 3 * 8 * sizeof(float), 8);
+	convertToAOSOA(3, dim(aosVectors), aosVectors, sizeof(float3), aosoaVectors, 3 * 8 * sizeof(float), 8, AOSOAM_Streaming);
+	convertFromAOSOA(3, dim(aosVectors), aosoaVectors, 3 * 8 * sizeof(float), aosVectors, sizeof(float3), 8);
+	storePartial(aosoaVectors, loadPartial<__m128>(aosoaVectors, 3), 3);
+	storePartial(aosoaVectors, loadPartial<__m256>(aosoaVectors, 5), 5);
+	storePartial(aosoaVectors, loadPartial<__m512>(aosoaVectors, 15), 15);
+	float3_simd8 simd8Chunk;
+	loadPartial(aosoaVectors, 5, &simd8Chunk);
+	storePartial(aosoaVectors, simd8Chunk, 5);
+	int gatherIndices[16] = { 9, 0, 4, 4, 1, 2, 3, 5, 6, 7, 8, 9, 0, 1, 2, 3, };
+	prefetchGather(aosVectors, gatherIndices, 8);
+	gather(aosVectors, gatherIndices, &simdVector);
+	gather(aosVectors, gatherIndices, &simd8Chunk);
+	gatherPartial(aosVectors, gatherIndices, 13, &simd16Vector);
+	scatter(simdVector, gatherIndices, aosVectors);
+	scatterPartial(simd8Chunk, gatherIndices, 5, aosVectors);
+	scatter(simd16Vector, gatherIndices, aosVectors);
+
+	horizontalSum(simdA);
+	horizontalMin(simd8IntA);
+	horizontalMax(simd16A);
+	horizontalMin(simdVector);
 }
 
 
@@ -403,6 +583,9 @@ void testBox()
 	foo5 = xfmBox(foo5, aff6);
 	isfinite(foo5);
 	round(foo5);
+
+	constexpr box3 cfoo3 = { 1, 2, 3, 4 };
+	cassert(cfoo3.mins[2] == 3.0f && cfoo3.maxs[0] == 4.0f && cfoo3.maxs[1] == 0.0f);
 }
 
 
@@ -424,6 +607,7 @@ void testQuat()
 	47.0f - q;
 	-q;
 	q * q;
+	quatProductSSE(q, q);
 	q * 47.0f;
 	47.0f * q;
 	q / 47.0f;
@@ -477,6 +661,13 @@ void testQuat()
 	maxComponent(q);
 	q = lerp(q, q, 0.5f);
 	q = square(q);
+	float3x3 stretch;
+	polarDecompose(float3x3(identity), &q, &stretch);
+
+	constexpr quat cq = conjugate(quat(0.0f, float3(1, 0, 0)) * quat(identity));
+	cassert(dot(cq, cq) == 1.0f && cq[1] == -1.0f);
+	constexpr float3 cv = applyQuat(quat(identity), float3(1, 2, 3));
+	cassert(cv[0] == 1.0f && cv[2] == 3.0f);
 }
 
 
@@ -489,6 +680,7 @@ void testColor()
 	rgba bar = { 1, 2, 3, 4 };
 	luminance(foo);
 	luminance(bar);
+	cassert(luminance(rgb(1.0f)) > 0.999f && luminance(rgb(1.0f)) < 1.001f);
 	blendOver(bar, foo);
 	blendOver(bar, bar);
 	premultiplyAlpha(bar);
@@ -1,11 +1,20 @@
 #include <cstdio>
+#include <cstring>
 
 void TestContainers();
+void BenchMath();
 
-int main (int /*argc*/, const char ** /*argv*/)
+int main (int argc, const char ** argv)
 {
 	// !!!UNDONE: command line processing to select subset of tests to run
 
+	// The benchmarks take a while, so they only run when asked for
+	if (argc > 1 && strcmp(argv[1], "-bench") == 0)
+	{
+		BenchMath();
+		return 0;
+	}
+
 	//TestMath();	// not yet implemented
 	//TestRNG();	// not yet implemented
 	TestContainers();
@@ -3,6 +3,7 @@
 #include <cstdarg>
 #include <cstdio>
 #include <limits>
+#include <thread>
 
 namespace util
 {
@@ -17,6 +18,32 @@ namespace util
 		::exit(1);
 	}
 
+	void parallelFor(size_t count, int numThreads, size_t minCountPerThread, std::function<void (size_t start, size_t end)> const & func)
+	{
+		if (numThreads <= 0)
+			numThreads = max(int(std::thread::hardware_concurrency()), 1);
+		if (minCountPerThread > 0)
+			numThreads = int(min(size_t(numThreads), max(count / minCountPerThread, size_t(1))));
+
+		if (numThreads <= 1)
+		{
+			func(0, count);
+			return;
+		}
+
+		size_t countPerThread = (count + numThreads - 1) / numThreads;
+		std::vector<std::thread> threads;
+		threads.reserve(numThreads - 1);
+		for (int i = 1; i < numThreads; ++i)
+		{
+			size_t start = min(i * countPerThread, count);
+			threads.emplace_back(func, start, min(start + countPerThread, count));
+		}
+		func(0, min(countPerThread, count));
+		for (auto & thread : threads)
+			thread.join();
+	}
+
 	bool LoadFile(const char * path, std::vector<byte> * pDataOut, LFK lfk /*= LFK_Binary*/)
 	{
 		ASSERT_ERR(path);
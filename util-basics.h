@@ -2,6 +2,7 @@
 #include <cmath>
 #include <cstdarg>
 #include <cstring>
+#include <functional>
 #include <ctype.h>
 #include <float.h>
 #include <string>
@@ -16,6 +17,16 @@ template <typename T, int N> char(&dim_helper(T(&)[N]))[N];
 // Compile-time assert
 #define cassert(x) static_assert(x, #x)
 
+// Fused multiply-add instructions can be used for the SIMD lane types by #defining ENABLE_FMA
+// to 1 or 0.  If not defined, it's on when compiling for AVX2 (which implies FMA3).
+#ifndef ENABLE_FMA
+#	if defined(__AVX2__) || defined(__FMA__)
+#		define ENABLE_FMA 1
+#	else
+#		define ENABLE_FMA 0
+#	endif
+#endif
+
 namespace util
 {
 	// "uint" is a lot shorter than "unsigned int"
@@ -44,27 +55,41 @@ namespace util
 
 	// Generic swap
 	template <typename T>
-	void swap(T & a, T & b) { T c = a; a = b; b = c; }
+	constexpr void swap(T & a, T & b) { T c = a; a = b; b = c; }
 
 	// Generic min/max/abs/clamp/saturate
 	template <typename T>
-	T min(T a, T b) { return (a < b) ? a : b; }
+	constexpr T min(T a, T b) { return (a < b) ? a : b; }
+	template <typename T>
+	constexpr T max(T a, T b) { return (a < b) ? b : a; }
 	template <typename T>
-	T max(T a, T b) { return (a < b) ? b : a; }
+	constexpr T abs(T a) { return (a < T(0)) ? -a : a; }
 	template <typename T>
-	T abs(T a) { return (a < T(0)) ? -a : a; }
+	constexpr T clamp(T value, T lower, T upper) { return min(max(value, lower), upper); }
+	template <typename T>
+	constexpr T saturate(T value) { return clamp(value, T(0), T(1)); }
+
+	// Generic splat: make a T from a float constant.  SIMD types specialize this to
+	// broadcast the value to all lanes, so generic code can use it for constants.
 	template <typename T>
-	T clamp(T value, T lower, T upper) { return min(max(value, lower), upper); }
+	T splat(float a) { return T(a); }
+
+	// Generic select: ternary operator as a function (for symmetry with the vector and SIMD versions)
 	template <typename T>
-	T saturate(T value) { return clamp(value, T(0), T(1)); }
+	constexpr T select(bool cond, T a, T b) { return cond ? a : b; }
+
+	// Generic fma: a*b + c, as a plain multiply and add.  For scalars, the standard fma is
+	// brought in with the other math functions below, and is preferred as an exact match.
+	template <typename T, typename U, typename V>
+	constexpr auto fma(T a, U b, V c) -> decltype(a*b + c) { return a*b + c; }
 
 	// Generic lerp
 	template <typename T>
-	T lerp(T a, T b, float u) { return a + (b - a) * u; }
+	T lerp(T a, T b, float u) { return fma(b - a, u, a); }
 
 	// Generic square
 	template <typename T>
-	T square(T a) { return a*a; }
+	constexpr T square(T a) { return a*a; }
 
 	// Equality test with epsilon
 	inline bool isnear(float a, float b, float eps = util::epsilon)
@@ -102,6 +127,25 @@ namespace util
 	inline float exp2f(float x) { return expf(0.693147181f * x); }
 	inline float log2f(float x) { return 1.442695041f * logf(x); }
 
+	// Bring the standard math functions into this namespace, so they overload with the vector
+	// and SIMD versions (otherwise unqualified calls within util would only find ours)
+	using ::sqrt;
+	using ::exp;
+	using ::exp2;
+	using ::log;
+	using ::log2;
+	using ::pow;
+	using ::sin;
+	using ::cos;
+	using ::acos;
+	using ::atan2;
+	using ::fma;
+
+	// Reciprocal, reciprocal square root, and sincos, for symmetry with the SIMD versions
+	inline float rcp(float x) { return 1.0f / x; }
+	inline float rsqrt(float x) { return 1.0f / sqrt(x); }
+	inline void sincos(float x, float * pSinOut, float * pCosOut) { *pSinOut = sin(x); *pCosOut = cos(x); }
+
 	// Integer log2, with rounding up or down
 	inline int log2_floor(int x) { if (x <= 0) return 0; unsigned long c = 0; _BitScanReverse(&c, x); return int(c); }
 	inline int log2_ceil(int x) { return (x > 0) ? (log2_floor(x - 1) + 1) : 0; }
@@ -121,9 +165,15 @@ namespace util
 	// Offset a pointer by a given number of bytes, regardless of pointer's type
 	// (note: number of bytes can be negative)
 	template <typename T>
-	inline T * offsetPtr(T * ptr, int bytes)
+	inline T * offsetPtr(T * ptr, ptrdiff_t bytes)
 		{ return (T *)((byte *)ptr + bytes); }
 
+	// Run a loop in parallel: split [0, count) into numThreads contiguous ranges and call
+	// func(start, end) for each one on its own thread (the calling thread does the first range),
+	// returning when they're all done.  numThreads <= 0 means one per hardware thread.
+	// Ranges are kept at least minCountPerThread long, so small loops don't get split.
+	void parallelFor(size_t count, int numThreads, size_t minCountPerThread, std::function<void (size_t start, size_t end)> const & func);
+
 	// Print an error message to stderr and immediately exit with code 1
 	void __declspec(noreturn) exit(const char * fmt, ...);
 
@@ -13,47 +13,33 @@ namespace util
 	{
 		vector<T, n> mins, maxs;
 
-		// Constructors
+		// Constructors (constexpr, except the default one)
 		box() {}
-		explicit box(emptyTag): mins(0), maxs(-1) {}
-		box(vector<T, n> mins_, vector<T, n> maxs_): mins(mins_), maxs(maxs_) {}
-		explicit box(T a): mins(a), maxs(a) {}
+		constexpr explicit box(emptyTag): mins(0), maxs(-1) {}
+		constexpr box(vector<T, n> mins_, vector<T, n> maxs_): mins(mins_), maxs(maxs_) {}
+		constexpr explicit box(T a): mins(a), maxs(a) {}
 		template <typename U>
-		explicit box(const U * p): mins(p), maxs(p + n) {}
-		box(std::initializer_list<vector<T, n>> initList)
+		constexpr explicit box(const U * p): mins(p), maxs(p + n) {}
+		constexpr box(std::initializer_list<vector<T, n>> initList)
+			: mins(*initList.begin()),
+			  maxs((initList.size() >= 2) ? initList.begin()[1] : *initList.begin())
+			{}
+		constexpr box(std::initializer_list<T> initList): mins(T(0)), maxs(T(0))
 		{
+			// Fill mins, then maxs; any remaining elements stay zero
+			int m = min(2*n, int(initList.size()));
 			auto iter = initList.begin();
-			if (initList.size() >= 1)
-				mins = *iter;
-			if (initList.size() >= 2)
-				maxs = *(++iter);
-			else
-				maxs = *iter;
-		}
-		box(std::initializer_list<T> initList)
-		{
-			int m = min(n, int(initList.size()));
-			auto iter = initList.begin();
-			for (int i = 0; i < m; ++i)
-			{
-				mins[i] = *iter;
-				++iter;
-			}
-			// Zero-fill any remaining elements
-			for (int i = m; i < n; ++i)
-				mins[i] = T(0);
-			m = min(n, int(initList.size()) - m);
 			for (int i = 0; i < m; ++i)
 			{
-				maxs[i] = *iter;
+				if (i < n)
+					mins[i] = *iter;
+				else
+					maxs[i - n] = *iter;
 				++iter;
 			}
-			// Zero-fill any remaining elements
-			for (int i = m; i < n; ++i)
-				maxs[i] = T(0);
 		}
 		template <typename U, int nOther>
-		explicit box(box<U, nOther> b): mins(b.mins), maxs(b.maxs) {}
+		constexpr explicit box(box<U, nOther> b): mins(b.mins), maxs(b.maxs) {}
 	};
 
 	// Typedefs for the most common types and dimensions
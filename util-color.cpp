@@ -60,12 +60,13 @@ namespace util
 
 	// White point for CIELAB conversion (in XYZ color space),
 	// chosen to make RGB (1, 1, 1) come out to CIELAB (100, 0, 0).
-	static const float xyzWhitePoint[] = { 0.9505f, 1.0f, 1.0887f };
+	static constexpr float3 xyzWhitePoint = { 0.9505f, 1.0f, 1.0887f };
 
 	float3 RGBtoCIELAB(rgb c)
 	{
-		// Convert RGB to XYZ color space
-		static const float3x3 RGBtoXYZ =
+		// Convert RGB to XYZ color space.  (The matrices are constexpr, so they're built at
+		// compile time, with no thread-safe static initialization to check on each call.)
+		static constexpr float3x3 RGBtoXYZ =
 		{
 			0.4124f, 0.2126f, 0.0193f,
 			0.3576f, 0.7152f, 0.1192f,
@@ -74,7 +75,7 @@ namespace util
 		float3 xyz = c * RGBtoXYZ;
 
 		// Convert to CIELAB space
-		xyz /= float3(xyzWhitePoint);
+		xyz /= xyzWhitePoint;
 		float3 warp = select(
 						xyz > 0.00885645f,
 						pow(xyz, 1.0f/3.0f),
@@ -98,10 +99,10 @@ namespace util
 						warp > 0.206897f,
 						warp * warp * warp,
 						(warp - 0.137931f) / 7.787037f);
-		xyz *= float3(xyzWhitePoint);
+		xyz *= xyzWhitePoint;
 
 		// Convert XYZ to RGB color space
-		static const float3x3 XYZtoRGB =
+		static constexpr float3x3 XYZtoRGB =
 		{
 			3.2406f, -0.9689f, 0.0557f,
 			-1.5372f, 1.8758f, -0.2040f,
@@ -15,11 +15,11 @@ namespace util
 
 
 	// Rec. 709 luma coefficients for linear RGB space
-	static const float lumaCoefficients[] = { 0.2126f, 0.7152f, 0.0722f };
-	inline float luminance(rgb c)
-		{ return dot(c, float3(lumaCoefficients)); }
+	static constexpr float3 lumaCoefficients = { 0.2126f, 0.7152f, 0.0722f };
+	constexpr float luminance(rgb c)
+		{ return dot(c, lumaCoefficients); }
 	inline float luminance(rgba c)
-		{ return dot(c.rgb, float3(lumaCoefficients)); }
+		{ return dot(c.rgb, lumaCoefficients); }
 
 	// Composition operator for linear RGB space (premultiplied alpha)
 	inline rgb blendOver(rgba a, rgb b)
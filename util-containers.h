@@ -1,6 +1,8 @@
 #pragma once
 #include "util-basics.h"
 #include "util-err.h"
+#include "util-math.h"
+#include <algorithm>
 #include <initializer_list>
 #include <type_traits>
 
@@ -25,8 +27,11 @@ namespace util
 		array(): data(nullptr), size(0) {}
 		array(T * data_, size_t size_): data(data_), size(size_) {}
 		template <typename U> array(std::initializer_list<U> initList): data(&(*initList.begin())), size(initList.size()) {}
-		template <typename U> array(array<U> a): data(a.data), size(a.size) {}
-		template <typename U, size_t N> array(U(& a)[N]): data(a), size(N) {}
+		// (Only enabled for compatible element types, so functions can be overloaded on array types)
+		template <typename U, typename = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+		array(array<U> a): data(a.data), size(a.size) {}
+		template <typename U, size_t N, typename = std::enable_if_t<std::is_convertible<U *, T *>::value>>
+		array(U(& a)[N]): data(a), size(N) {}
 
 		// Create a "view" of a sub-range of the array
 		array<T> slice(size_t start, size_t sliceSize)
@@ -169,8 +174,841 @@ namespace util
 				data[size+i] = T(data_[i]);
 			size += size_;
 		}
+		void resize(size_t sizeNew)
+		{
+			// New elements are default-constructed, i.e. uninitialized for trivial types
+			ensureCapacity(sizeNew);
+			size = sizeNew;
+		}
 	};
 
+	// AOSOA array: owns storage for an array of N-component vectors of T (float or int),
+	// laid out in SIMD-friendly chunks of W vectors each, like convertToAOSOA produces.
+	// The chunks can be accessed directly as SIMD vectors, e.g. vector<__m128, 3> for
+	// aosoa_array<float, 3, 4>, while individual elements are accessed as scalar vectors.
+	// Storage is aligned for the SIMD type, and the unused lanes of the last chunk are always
+	// zero, so SIMD code can process whole chunks without special-casing the tail.
+	template <typename T, int N, int W = 4>
+	struct aosoa_array
+	{
+		typedef typename simd_lane<T, W>::type lane_type;
+		typedef vector<lane_type, N> chunk_type;
+		typedef vector<T, N> element_type;
+
+		chunk_type *	data;
+		size_t			size;		// Count of elements, not chunks
+		size_t			capacity;	// Also in elements; always a multiple of W
+
+		// Constructors
+		aosoa_array(): data(nullptr), size(0), capacity(0) {}
+		explicit aosoa_array(size_t capacityInitial): aosoa_array() { ensureCapacity(capacityInitial); }
+		explicit aosoa_array(array<element_type> a): aosoa_array() { appendSeveral(a); }
+
+		// Copy, move, destruct
+		aosoa_array(aosoa_array const & a): aosoa_array()
+		{
+			ensureCapacity(a.size);
+			memcpy(data, a.data, a.numChunks() * sizeof(chunk_type));
+			size = a.size;
+		}
+		aosoa_array(aosoa_array && a): data(a.data), size(a.size), capacity(a.capacity)
+		{
+			a.data = nullptr;
+			a.size = 0;
+			a.capacity = 0;
+		}
+		aosoa_array & operator = (aosoa_array a)
+		{
+			swap(data, a.data);
+			swap(size, a.size);
+			swap(capacity, a.capacity);
+			return *this;
+		}
+		~aosoa_array() { reset(); }
+
+		// Chunk accessors
+		size_t numChunks() const { return (size + W - 1) / W; }
+		chunk_type & chunk(size_t iChunk)
+		{
+			ASSERT_ERR(iChunk < numChunks());
+			return data[iChunk];
+		}
+		const chunk_type & chunk(size_t iChunk) const
+		{
+			ASSERT_ERR(iChunk < numChunks());
+			return data[iChunk];
+		}
+		array<chunk_type> chunks() { return { data, numChunks() }; }
+		array<const chunk_type> chunks() const { return { data, numChunks() }; }
+
+		// Element accessors.  Since the components of an element aren't contiguous,
+		// elements are accessed by value, or by individual component.
+		T & component(size_t i, int j)
+		{
+			ASSERT_ERR(i < size);
+			ASSERT_ERR(j >= 0 && j < N);
+			return ((T *)&data[i / W])[j*W + i % W];
+		}
+		const T & component(size_t i, int j) const
+		{
+			ASSERT_ERR(i < size);
+			ASSERT_ERR(j >= 0 && j < N);
+			return ((const T *)&data[i / W])[j*W + i % W];
+		}
+		element_type get(size_t i) const
+		{
+			element_type result;
+			for (int j = 0; j < N; ++j)
+				result[j] = component(i, j);
+			return result;
+		}
+		void set(size_t i, element_type v)
+		{
+			for (int j = 0; j < N; ++j)
+				component(i, j) = v[j];
+		}
+
+		// Methods for managing memory allocation
+		void ensureCapacity(size_t capacityNeeded)
+		{
+			if (capacityNeeded <= capacity)
+				return;
+
+			static const size_t capacityStarter = 8 * W;
+			size_t capacityNew = max(capacityNeeded, max(2 * capacity, capacityStarter));
+			capacityNew = (capacityNew + W - 1) / W * W;
+
+			// New chunks are zeroed, to maintain zero padding
+			chunk_type * dataOld = data;
+			chunk_type * dataNew = (chunk_type *)_mm_malloc(capacityNew / W * sizeof(chunk_type), sizeof(lane_type));
+			memcpy(dataNew, dataOld, numChunks() * sizeof(chunk_type));
+			memset(dataNew + numChunks(), 0, (capacityNew / W - numChunks()) * sizeof(chunk_type));
+			data = dataNew;
+			capacity = capacityNew;
+			_mm_free(dataOld);
+		}
+		void reset()
+		{
+			_mm_free(data);
+			data = nullptr;
+			size = 0;
+			capacity = 0;
+		}
+
+		// Methods for adding and removing data
+		void append(element_type v)
+		{
+			ensureCapacity(size + 1);
+			++size;
+			set(size - 1, v);
+		}
+		void appendSeveral(array<element_type> a)
+		{
+			if (a.size == 0)
+				return;
+			ensureCapacity(size + a.size);
+
+			// Fill out the current partial chunk one at a time, then convert the rest in bulk
+			size_t i = 0;
+			for (; i < a.size && size % W != 0; ++i)
+				append(a.data[i]);
+			if (i < a.size)
+			{
+				convertToAOSOA(
+					N, int(a.size - i),
+					&a.data[i], sizeof(element_type),
+					&data[size / W], sizeof(chunk_type),
+					W);
+				size += a.size - i;
+			}
+		}
+		void resize(size_t sizeNew)
+		{
+			ensureCapacity(sizeNew);
+			if (sizeNew < size)
+				zeroElements(sizeNew, size);
+			size = sizeNew;
+		}
+		void removeSwap(size_t i)
+		{
+			ASSERT_ERR(i < size);
+			if (i < size - 1)
+				set(i, get(size - 1));
+			zeroElements(size - 1, size);
+			--size;
+		}
+		void clear()
+		{
+			memset(data, 0, numChunks() * sizeof(chunk_type));
+			size = 0;
+		}
+
+		// Copy all the elements out to a regular array
+		void copyTo(array<element_type> a) const
+		{
+			ASSERT_ERR(a.size >= size);
+			if (size == 0)
+				return;
+			convertFromAOSOA(
+				N, int(size),
+				data, sizeof(chunk_type),
+				a.data, sizeof(element_type),
+				W);
+		}
+
+	private:
+		void zeroElements(size_t start, size_t end)
+		{
+			for (size_t i = start; i < end; ++i)
+			{
+				for (int j = 0; j < N; ++j)
+					component(i, j) = T(0);
+			}
+		}
+	};
+
+	// Dense matrix with its size chosen at runtime, for problems too big for the fixed-size
+	// matrix types, e.g. least-squares fits or small neural-net layers.  Storage is row-major,
+	// with each row aligned to 64 bytes and padded out to a multiple of 64 bytes, so SIMD code
+	// can process whole rows without special-casing the tail.  The padding is zeroed when the
+	// storage is allocated.
+	template <typename T>
+	struct dmatrix
+	{
+		static const int alignBytes = 64;
+
+		T *		data;
+		int		rows;
+		int		cols;
+		int		stride;		// Distance between the start of each row, in elements
+
+		// Constructors; the entries start out zero
+		dmatrix(): data(nullptr), rows(0), cols(0), stride(0) {}
+		dmatrix(int rows_, int cols_): dmatrix() { resize(rows_, cols_); }
+		dmatrix(int rows_, int cols_, array<const T> a): dmatrix(rows_, cols_)
+		{
+			// a is row-major and tightly packed
+			ASSERT_ERR(a.size >= size_t(rows_) * size_t(cols_));
+			for (int i = 0; i < rows; ++i)
+				memcpy(&data[i * stride], &a.data[i * cols], cols * sizeof(T));
+		}
+		template <int r, int c>
+		explicit dmatrix(matrix<T, r, c> const & m): dmatrix(r, c, array<const T>(m.data, r * c)) {}
+
+		// Copy, move, destruct
+		dmatrix(dmatrix const & a): dmatrix()
+		{
+			resize(a.rows, a.cols);
+			memcpy(data, a.data, size_t(rows) * stride * sizeof(T));
+		}
+		dmatrix(dmatrix && a): data(a.data), rows(a.rows), cols(a.cols), stride(a.stride)
+		{
+			a.data = nullptr;
+			a.rows = 0;
+			a.cols = 0;
+			a.stride = 0;
+		}
+		dmatrix & operator = (dmatrix a)
+		{
+			swap(data, a.data);
+			swap(rows, a.rows);
+			swap(cols, a.cols);
+			swap(stride, a.stride);
+			return *this;
+		}
+		~dmatrix() { reset(); }
+
+		// Accessors
+		T & operator () (int i, int j)
+		{
+			ASSERT_ERR(i >= 0 && i < rows);
+			ASSERT_ERR(j >= 0 && j < cols);
+			return data[i * stride + j];
+		}
+		const T & operator () (int i, int j) const
+		{
+			ASSERT_ERR(i >= 0 && i < rows);
+			ASSERT_ERR(j >= 0 && j < cols);
+			return data[i * stride + j];
+		}
+		array<T> row(int i)
+		{
+			ASSERT_ERR(i >= 0 && i < rows);
+			return { &data[i * stride], size_t(cols) };
+		}
+		array<const T> row(int i) const
+		{
+			ASSERT_ERR(i >= 0 && i < rows);
+			return { &data[i * stride], size_t(cols) };
+		}
+
+		// Copy a fixed-size block out of the matrix, or into it, with its top left at (i, j)
+		template <int r, int c>
+		matrix<T, r, c> getBlock(int i, int j) const
+		{
+			ASSERT_ERR(i >= 0 && i + r <= rows);
+			ASSERT_ERR(j >= 0 && j + c <= cols);
+			matrix<T, r, c> result;
+			for (int k = 0; k < r; ++k)
+				memcpy(&result.data[k * c], &data[(i + k) * stride + j], c * sizeof(T));
+			return result;
+		}
+		template <int r, int c>
+		void setBlock(int i, int j, matrix<T, r, c> const & m)
+		{
+			ASSERT_ERR(i >= 0 && i + r <= rows);
+			ASSERT_ERR(j >= 0 && j + c <= cols);
+			for (int k = 0; k < r; ++k)
+				memcpy(&data[(i + k) * stride + j], &m.data[k * c], c * sizeof(T));
+		}
+
+		// Methods for managing memory allocation.  Resizing doesn't preserve the contents;
+		// the matrix is all zeros afterward.
+		void resize(int rowsNew, int colsNew)
+		{
+			ASSERT_ERR(rowsNew >= 0 && colsNew >= 0);
+			int strideNew = (colsNew * int(sizeof(T)) + alignBytes - 1) / alignBytes * alignBytes / int(sizeof(T));
+			if (size_t(rowsNew) * strideNew != size_t(rows) * stride)
+			{
+				_mm_free(data);
+				data = (rowsNew * strideNew > 0) ? (T *)_mm_malloc(size_t(rowsNew) * strideNew * sizeof(T), alignBytes) : nullptr;
+			}
+			rows = rowsNew;
+			cols = colsNew;
+			stride = strideNew;
+			setZero();
+		}
+		void setZero()
+		{
+			if (data)
+				memset(data, 0, size_t(rows) * stride * sizeof(T));
+		}
+		void reset()
+		{
+			_mm_free(data);
+			data = nullptr;
+			rows = 0;
+			cols = 0;
+			stride = 0;
+		}
+	};
+
+	// Transpose of a dmatrix, done in square tiles so that both the reads and the writes
+	// stay within a few cache lines at a time
+	template <typename T>
+	void transpose(dmatrix<T> const & a, dmatrix<T> * pOut)
+	{
+		ASSERT_ERR(pOut && pOut != &a);
+
+		static const int tileSize = 32;
+		pOut->resize(a.cols, a.rows);
+		for (int i0 = 0; i0 < a.rows; i0 += tileSize)
+		{
+			int i1 = min(i0 + tileSize, a.rows);
+			for (int j0 = 0; j0 < a.cols; j0 += tileSize)
+			{
+				int j1 = min(j0 + tileSize, a.cols);
+				for (int i = i0; i < i1; ++i)
+					for (int j = j0; j < j1; ++j)
+						pOut->data[j * pOut->stride + i] = a.data[i * a.stride + j];
+			}
+		}
+	}
+
+	namespace impl
+	{
+		// Whether two arrays share any memory
+		template <typename T, typename U>
+		bool overlaps(const T * a, size_t countA, const U * b, size_t countB)
+		{
+			return (const byte *)a < (const byte *)(b + countB) &&
+				   (const byte *)b < (const byte *)(a + countA);
+		}
+	}
+
+	// Matrix product, *pOut = a * b, split by rows of the output over numThreads threads
+	// (0 = one per hardware thread); see parallelFor().  This generic version is a simple
+	// loop nest, ordered so the innermost loop runs along rows of b and the output; the float
+	// version below is cache-blocked and vectorized.
+	template <typename T>
+	void multiply(dmatrix<T> const & a, dmatrix<T> const & b, dmatrix<T> * pOut, int numThreads = 1)
+	{
+		ASSERT_ERR(a.cols == b.rows);
+		ASSERT_ERR(pOut && pOut != &a && pOut != &b);
+
+		pOut->resize(a.rows, b.cols);
+		parallelFor(
+			a.rows, numThreads, 16,
+			[&](size_t start, size_t end)
+			{
+				for (int i = int(start); i < int(end); ++i)
+				{
+					T * pRowOut = &pOut->data[i * pOut->stride];
+					for (int k = 0; k < a.cols; ++k)
+					{
+						T aik = a.data[i * a.stride + k];
+						const T * pRowB = &b.data[k * b.stride];
+						for (int j = 0; j < b.cols; ++j)
+							pRowOut[j] += aik * pRowB[j];
+					}
+				}
+			});
+	}
+
+	// Matrix times column vector, yOut = a * x.  yOut must not overlap a or x.
+	template <typename T>
+	void multiply(dmatrix<T> const & a, array<const T> x, array<T> yOut, int numThreads = 1)
+	{
+		ASSERT_ERR(x.size >= size_t(a.cols));
+		ASSERT_ERR(yOut.size >= size_t(a.rows));
+		ASSERT_ERR(!impl::overlaps(yOut.data, a.rows, a.data, size_t(a.rows) * a.stride));
+		ASSERT_ERR(!impl::overlaps(yOut.data, a.rows, x.data, a.cols));
+
+		parallelFor(
+			a.rows, numThreads, 256,
+			[&](size_t start, size_t end)
+			{
+				for (int i = int(start); i < int(end); ++i)
+				{
+					const T * pRow = &a.data[i * a.stride];
+					T result(0);
+					for (int j = 0; j < a.cols; ++j)
+						result += pRow[j] * x.data[j];
+					yOut.data[i] = result;
+				}
+			});
+	}
+
+	// Float versions, with the widest SIMD available (see detectISA()).  The matrix product
+	// packs panels of b into cache-sized blocks, and computes the output in register-sized
+	// tiles from them.
+	void multiply(dmatrix<float> const & a, dmatrix<float> const & b, dmatrix<float> * pOut, int numThreads = 1);
+	void multiply(dmatrix<float> const & a, array<const float> x, array<float> yOut, int numThreads = 1);
+
+	// Solve a * x = b for x, with one right-hand side per column of b, by Gaussian elimination
+	// with partial pivoting on copies of a and b.  Fails if a pivot is smaller than epsilon,
+	// i.e. a is singular or nearly so.  The eliminations work on whole rows at a time.
+	template <typename T>
+	bool trySolve(dmatrix<T> const & a, dmatrix<T> const & b, dmatrix<T> * pXOut, float epsilon = util::epsilon)
+	{
+		ASSERT_ERR(a.rows == a.cols);
+		ASSERT_ERR(b.rows == a.rows);
+		ASSERT_ERR(pXOut && pXOut != &a);
+
+		int n = a.rows;
+		dmatrix<T> lu(a);
+		dmatrix<T> x(b);
+
+		// Forward elimination
+		for (int k = 0; k < n; ++k)
+		{
+			// Pick the row with the largest entry in this column as the pivot
+			int iPivot = k;
+			for (int i = k + 1; i < n; ++i)
+			{
+				if (abs(lu(i, k)) > abs(lu(iPivot, k)))
+					iPivot = i;
+			}
+			if (abs(lu(iPivot, k)) < epsilon)
+				return false;
+			if (iPivot != k)
+			{
+				for (int j = k; j < n; ++j)
+					swap(lu(k, j), lu(iPivot, j));
+				for (int j = 0; j < x.cols; ++j)
+					swap(x(k, j), x(iPivot, j));
+			}
+
+			T rcpPivot = T(1) / lu(k, k);
+			const T * pRowK = &lu.data[k * lu.stride];
+			const T * pRowXK = &x.data[k * x.stride];
+			for (int i = k + 1; i < n; ++i)
+			{
+				T factor = lu(i, k) * rcpPivot;
+				if (factor == T(0))
+					continue;
+				T * pRowI = &lu.data[i * lu.stride];
+				for (int j = k + 1; j < n; ++j)
+					pRowI[j] -= factor * pRowK[j];
+				T * pRowXI = &x.data[i * x.stride];
+				for (int j = 0; j < x.cols; ++j)
+					pRowXI[j] -= factor * pRowXK[j];
+			}
+		}
+
+		// Back substitution
+		for (int i = n - 1; i >= 0; --i)
+		{
+			T * pRowXI = &x.data[i * x.stride];
+			for (int k = i + 1; k < n; ++k)
+			{
+				T factor = lu(i, k);
+				const T * pRowXK = &x.data[k * x.stride];
+				for (int j = 0; j < x.cols; ++j)
+					pRowXI[j] -= factor * pRowXK[j];
+			}
+			T rcpDiag = T(1) / lu(i, i);
+			for (int j = 0; j < x.cols; ++j)
+				pRowXI[j] *= rcpDiag;
+		}
+
+		*pXOut = std::move(x);
+		return true;
+	}
+
+	// Solve a * x = b for a single right-hand side vector
+	template <typename T>
+	bool trySolve(dmatrix<T> const & a, array<const T> b, array<T> xOut, float epsilon = util::epsilon)
+	{
+		ASSERT_ERR(b.size >= size_t(a.rows));
+		ASSERT_ERR(xOut.size >= size_t(a.cols));
+
+		dmatrix<T> x;
+		if (!trySolve(a, dmatrix<T>(a.rows, 1, b), &x, epsilon))
+			return false;
+		for (int i = 0; i < a.rows; ++i)
+			xOut.data[i] = x.data[i * x.stride];
+		return true;
+	}
+
+	// Sparse matrix in compressed sparse row (CSR) format: the stored entries of each row are
+	// consecutive, along with their column indices, and rowStarts[i] is the index of row i's
+	// first entry (rowStarts[rows()] is the total count).  The entries can be scalars, or small
+	// square matrices for block-CSR, e.g. float3x3 for systems with a 3D vector per unknown,
+	// as in cloth simulation; each block is then one "entry" of a matrix of 3x3 blocks.
+	// Build it a row at a time with appendEntry() and endRow(), or from unordered entries
+	// with buildCSRMatrix().  (Not copyable, as dynarray's copy is shallow.)
+	template <typename T>
+	struct csrmatrix
+	{
+		dynarray<T>		values;
+		dynarray<int>	columns;
+		dynarray<int>	rowStarts;
+		int				cols;
+
+		// Constructors; the matrix starts out with no rows
+		csrmatrix(): cols(0) { rowStarts.append(0); }
+		explicit csrmatrix(int cols_): cols(cols_) { rowStarts.append(0); }
+		csrmatrix(csrmatrix const &) = delete;
+		csrmatrix & operator = (csrmatrix const &) = delete;
+
+		int rows() const { return int(rowStarts.size) - 1; }
+		int numEntries() const { return int(values.size); }
+
+		// Add an entry to the current row, then end it to start the next one
+		void appendEntry(int col, T value)
+		{
+			ASSERT_ERR(col >= 0 && col < cols);
+			columns.append(col);
+			values.append(value);
+		}
+		void endRow() { rowStarts.append(int(values.size)); }
+
+		// Find the stored entry at (i, j), or nullptr if there isn't one
+		const T * find(int i, int j) const
+		{
+			ASSERT_ERR(i >= 0 && i < rows());
+			for (int k = rowStarts.data[i]; k < rowStarts.data[i + 1]; ++k)
+			{
+				if (columns.data[k] == j)
+					return &values.data[k];
+			}
+			return nullptr;
+		}
+
+		void clear(int colsNew)
+		{
+			values.clear();
+			columns.clear();
+			rowStarts.clear();
+			rowStarts.append(0);
+			cols = colsNew;
+		}
+	};
+
+	// An entry for building a csrmatrix from unordered (row, column, value) entries
+	template <typename T>
+	struct csrentry
+	{
+		int		row;
+		int		col;
+		T		value;
+	};
+
+	// Build a csrmatrix from entries in any order, e.g. the per-element contributions of a
+	// finite element assembly.  Each row's entries come out sorted by column, and entries with
+	// the same row and column are summed.
+	template <typename T>
+	void buildCSRMatrix(int rows, int cols, array<const csrentry<T>> entries, csrmatrix<T> * pOut)
+	{
+		ASSERT_ERR(rows >= 0 && cols >= 0);
+		ASSERT_ERR(pOut);
+
+		// Bucket the entries by row (a counting sort), then sort each row by column
+		dynarray<int> rowCounts;
+		rowCounts.resize(rows + 1);
+		memset(rowCounts.data, 0, rowCounts.size * sizeof(int));
+		for (size_t k = 0; k < entries.size; ++k)
+		{
+			ASSERT_ERR(entries.data[k].row >= 0 && entries.data[k].row < rows);
+			++rowCounts.data[entries.data[k].row + 1];
+		}
+		for (int i = 0; i < rows; ++i)
+			rowCounts.data[i + 1] += rowCounts.data[i];
+
+		dynarray<int> order;
+		order.resize(entries.size);
+		for (size_t k = 0; k < entries.size; ++k)
+			order.data[rowCounts.data[entries.data[k].row]++] = int(k);
+
+		pOut->clear(cols);
+		int rowStart = 0;
+		for (int i = 0; i < rows; ++i)
+		{
+			int rowEnd = rowCounts.data[i];
+			std::sort(
+				order.data + rowStart, order.data + rowEnd,
+				[&](int a, int b) { return entries.data[a].col < entries.data[b].col; });
+			for (int k = rowStart; k < rowEnd; ++k)
+			{
+				csrentry<T> const & entry = entries.data[order.data[k]];
+				if (k > rowStart && entry.col == pOut->columns.data[pOut->columns.size - 1])
+					pOut->values.data[pOut->values.size - 1] += entry.value;
+				else
+					pOut->appendEntry(entry.col, entry.value);
+			}
+			pOut->endRow();
+			rowStart = rowEnd;
+		}
+	}
+
+	// Sparse matrix times vector, yOut = a * x, split by rows over numThreads threads
+	// (0 = one per hardware thread); see parallelFor().  For block-CSR, x and yOut are arrays
+	// of vectors, e.g. float3 for float3x3 blocks.  The float and float3x3 versions below
+	// use SIMD.
+	template <typename T, typename V>
+	void multiply(csrmatrix<T> const & a, array<const V> x, array<V> yOut, int numThreads = 1)
+	{
+		ASSERT_ERR(x.size >= size_t(a.cols));
+		ASSERT_ERR(yOut.size >= size_t(a.rows()));
+		ASSERT_ERR(x.data != yOut.data);
+
+		parallelFor(
+			a.rows(), numThreads, 4096,
+			[&](size_t start, size_t end)
+			{
+				for (int i = int(start); i < int(end); ++i)
+				{
+					V result(0.0f);
+					for (int k = a.rowStarts.data[i]; k < a.rowStarts.data[i + 1]; ++k)
+						result += a.values.data[k] * x.data[a.columns.data[k]];
+					yOut.data[i] = result;
+				}
+			});
+	}
+
+	void multiply(csrmatrix<float> const & a, array<const float> x, array<float> yOut, int numThreads = 1);
+	void multiply(csrmatrix<float3x3> const & a, array<const float3> x, array<float3> yOut, int numThreads = 1);
+
+	namespace impl
+	{
+		// Sum func(start, end) over blocks of [0, count), in parallel.  The blocks don't depend
+		// on the number of threads, so neither does the result.
+		template <typename R, typename Func>
+		R parallelSum(size_t count, int numThreads, Func func)
+		{
+			static const size_t blockSize = 16 * 1024;
+			size_t numBlocks = (count + blockSize - 1) / blockSize;
+			dynarray<R> blockSums;
+			blockSums.resize(numBlocks);
+			parallelFor(
+				numBlocks, numThreads, 1,
+				[&](size_t start, size_t end)
+				{
+					for (size_t i = start; i < end; ++i)
+						blockSums.data[i] = func(i * blockSize, min((i + 1) * blockSize, count));
+				});
+
+			R result(0.0);
+			for (size_t i = 0; i < numBlocks; ++i)
+				result += blockSums.data[i];
+			return result;
+		}
+
+		// Scalar and block versions of the pieces conjugate gradient needs
+		inline double cgDot(float a, float b) { return double(a) * double(b); }
+		inline double cgDot(double a, double b) { return a * b; }
+		template <typename T, int n>
+		double cgDot(vector<T, n> const & a, vector<T, n> const & b) { return double(dot(a, b)); }
+		inline float cgInvertDiagonal(float a) { return 1.0f / a; }
+		inline double cgInvertDiagonal(double a) { return 1.0 / a; }
+		template <typename T, int n>
+		matrix<T, n, n> cgInvertDiagonal(matrix<T, n, n> const & a) { return inverse(a); }
+
+		// Scalar type of a solution vector, for the step sizes
+		template <typename V> struct cgScalar { typedef V type; };
+		template <typename T, int n> struct cgScalar<vector<T, n>> { typedef T type; };
+	}
+
+	// Solve a * x = b for x by the preconditioned conjugate gradient method, for a symmetric
+	// positive definite a, such as from a Poisson problem or an implicit cloth step.  On input,
+	// x holds the initial guess (e.g. the previous frame's solution, or zero).  Iterates until
+	// length(residual) <= tolerance * length(b) (or <= tolerance, if b is zero), returning
+	// true, or until maxIterations, returning false; either way x holds the last iterate.
+	// An initial guess that already meets the tolerance returns true without iterating.
+	// The preconditioner is Jacobi, i.e. the inverse of the diagonal (block-Jacobi for
+	// block-CSR), so every row must have a diagonal entry.  Vector operations and
+	// multiplications by a are split over numThreads threads, as in multiply(), and the
+	// vectors are summed in double precision.
+	template <typename T, typename V>
+	bool trySolveConjugateGradient(
+		csrmatrix<T> const & a,
+		array<const V> b,
+		array<V> x,
+		float tolerance = 1e-6f,
+		int maxIterations = 1000,
+		int numThreads = 1)
+	{
+		ASSERT_ERR(a.rows() == a.cols);
+		ASSERT_ERR(b.size >= size_t(a.rows()));
+		ASSERT_ERR(x.size >= size_t(a.rows()));
+
+		size_t n = size_t(a.rows());
+		dynarray<T> diagonalInverse;
+		dynarray<V> r, z, p, ap;
+		diagonalInverse.resize(n);
+		r.resize(n);
+		z.resize(n);
+		p.resize(n);
+		ap.resize(n);
+		for (size_t i = 0; i < n; ++i)
+		{
+			const T * pDiagonal = a.find(int(i), int(i));
+			ASSERT_ERR(pDiagonal);
+			diagonalInverse.data[i] = impl::cgInvertDiagonal(*pDiagonal);
+		}
+
+		typedef typename impl::cgScalar<V>::type Scalar;
+
+		// r = b - a x, z = M^-1 r, p = z; the sums are dot(r, r) and dot(r, z)
+		multiply(a, array<const V>(x.data, n), array<V>(ap.data, n), numThreads);
+		vector<double, 2> initialSums = impl::parallelSum<vector<double, 2>>(n, numThreads, [&](size_t start, size_t end)
+		{
+			vector<double, 2> sum(0.0);
+			for (size_t i = start; i < end; ++i)
+			{
+				r.data[i] = b.data[i] - ap.data[i];
+				z.data[i] = diagonalInverse.data[i] * r.data[i];
+				p.data[i] = z.data[i];
+				sum.x += impl::cgDot(r.data[i], r.data[i]);
+				sum.y += impl::cgDot(r.data[i], z.data[i]);
+			}
+			return sum;
+		});
+		double rz = initialSums.y;
+		double bb = impl::parallelSum<double>(n, numThreads, [&](size_t start, size_t end)
+		{
+			double sum = 0.0;
+			for (size_t i = start; i < end; ++i)
+				sum += impl::cgDot(b.data[i], b.data[i]);
+			return sum;
+		});
+		double threshold = double(tolerance) * double(tolerance) * ((bb > 0.0) ? bb : 1.0);
+		if (initialSums.x <= threshold)
+			return true;
+
+		for (int iteration = 0; iteration < maxIterations; ++iteration)
+		{
+			multiply(a, array<const V>(p.data, n), array<V>(ap.data, n), numThreads);
+			double pap = impl::parallelSum<double>(n, numThreads, [&](size_t start, size_t end)
+			{
+				double sum = 0.0;
+				for (size_t i = start; i < end; ++i)
+					sum += impl::cgDot(p.data[i], ap.data[i]);
+				return sum;
+			});
+			if (pap <= 0.0)
+				return false;
+
+			// Step x and r, and precondition the new residual, all in one pass; the sums are
+			// dot(r, r) for the convergence test and dot(r, z) for the next step
+			Scalar alpha = Scalar(rz / pap);
+			vector<double, 2> sums = impl::parallelSum<vector<double, 2>>(n, numThreads, [&](size_t start, size_t end)
+			{
+				vector<double, 2> sum(0.0);
+				for (size_t i = start; i < end; ++i)
+				{
+					x.data[i] += alpha * p.data[i];
+					r.data[i] -= alpha * ap.data[i];
+					z.data[i] = diagonalInverse.data[i] * r.data[i];
+					sum.x += impl::cgDot(r.data[i], r.data[i]);
+					sum.y += impl::cgDot(r.data[i], z.data[i]);
+				}
+				return sum;
+			});
+			if (sums.x <= threshold)
+				return true;
+
+			Scalar beta = Scalar(sums.y / rz);
+			rz = sums.y;
+			parallelFor(n, numThreads, 16 * 1024, [&](size_t start, size_t end)
+			{
+				for (size_t i = start; i < end; ++i)
+					p.data[i] = z.data[i] + beta * p.data[i];
+			});
+		}
+
+		return false;
+	}
+
+	// Batch versions of dot and length over arrays of vectors, writing one float per vector.
+	// These convert blocks of the input to AOSOA internally and do the math with the widest
+	// SIMD lane type available (see detectISA()).  The output array must be at least as large
+	// as the input(s).
+	void dotBatch(array<const float2> a, array<const float2> b, array<float> dotsOut);
+	void dotBatch(array<const float3> a, array<const float3> b, array<float> dotsOut);
+	void dotBatch(array<const float4> a, array<const float4> b, array<float> dotsOut);
+	void lengthBatch(array<const float2> a, array<float> lengthsOut);
+	void lengthBatch(array<const float3> a, array<float> lengthsOut);
+	void lengthBatch(array<const float4> a, array<float> lengthsOut);
+
+	// Batch versions of xfmPoint and xfmVector, transforming arrays of 3D points or vectors.
+	// projectPointBatch transforms by a full 4x4 matrix, such as from perspProjD3DStyle(), and
+	// divides by w.  The output array must be at least as large as the input, and can be the
+	// same array.  Large arrays can be split over numThreads threads (0 = one per hardware
+	// thread); see parallelFor().
+	void xfmPointBatch(array<const float3> points, affine3 const & xfm, array<float3> pointsOut, int numThreads = 1);
+	void xfmVectorBatch(array<const float3> vectors, affine3 const & xfm, array<float3> vectorsOut, int numThreads = 1);
+	void xfmVectorBatch(array<const float3> vectors, float3x3 const & xfm, array<float3> vectorsOut, int numThreads = 1);
+	void projectPointBatch(array<const float3> points, float4x4 const & xfm, array<float3> pointsOut, int numThreads = 1);
+
+	// Versions with a stride in bytes between the vectors, for 3D vectors interleaved with
+	// other data (e.g. positions in a vertex buffer).  The xyz components must be tightly packed.
+	void xfmPointBatch(int numPoints, const void * pPoints, int inputStrideBytes, affine3 const & xfm, void * pPointsOut, int outputStrideBytes, int numThreads = 1);
+	void xfmVectorBatch(int numVectors, const void * pVectors, int inputStrideBytes, affine3 const & xfm, void * pVectorsOut, int outputStrideBytes, int numThreads = 1);
+	void xfmVectorBatch(int numVectors, const void * pVectors, int inputStrideBytes, float3x3 const & xfm, void * pVectorsOut, int outputStrideBytes, int numThreads = 1);
+	void projectPointBatch(int numPoints, const void * pPoints, int inputStrideBytes, float4x4 const & xfm, void * pPointsOut, int outputStrideBytes, int numThreads = 1);
+
+	// Batch versions of applyQuat, rotating an array of vectors by one quat, or each vector by
+	// the corresponding quat in an array (e.g. skinned vertices, with their bones' rotations
+	// gathered per vertex).  The quats must be normalized.  Threading and the output array
+	// work as in the batch transforms above.
+	void applyQuatBatch(quat q, array<const float3> vectors, array<float3> vectorsOut, int numThreads = 1);
+	void applyQuatBatch(array<const quat> quats, array<const float3> vectors, array<float3> vectorsOut, int numThreads = 1);
+
+	// Batch inverse and determinant of arrays of 4x4 matrices.  These transpose groups of 4 or
+	// 8 matrices into SIMD lanes and do them all at once (see the tryInvertMatrix overloads for
+	// SIMD matrices).  Matrices with abs(det) <= epsilon times the product of their row lengths
+	// are singular: their inverses come out as zero, and if singularOut is given, their entries
+	// in it are set to true.
+	void inverseBatch(array<const float4x4> matrices, array<float4x4> inversesOut, array<bool> singularOut = array<bool>(), float epsilon = util::epsilon);
+	void determinantBatch(array<const float4x4> matrices, array<float> determinantsOut);
+
+	// Batch eigendecomposition of symmetric 3x3 matrices, e.g. covariance or inertia tensors,
+	// running eigenDecomposeSymmetric on 4 or 8 matrices at a time in SIMD lanes.  Either
+	// output may be empty, to skip storing it.
+	void eigenDecomposeSymmetricBatch(array<const float3x3> matrices, array<float3> eigenvaluesOut, array<float3x3> eigenvectorsOut = array<float3x3>(), int numThreads = 1);
+
 	// NYI:
 	//   * sorting and searching
 	//   * map, reduce, filter
@@ -6,6 +6,7 @@
 #include "util-vector.h"
 #include "util-matrix.h"
 #include "util-simd.h"
+#include "util-simd-math.h"
 #include "util-box.h"
 #include "util-color.h"
 #include "util-quat.h"
@@ -20,9 +20,11 @@ namespace util
 		const vector<T, cols> & operator [] (int i) const
 			{ return reinterpret_cast<const vector<T, cols> &>(data[i*cols]); }
 
-		// Constructors
+		// Constructors.  All but the default one are constexpr, so matrices can be built at
+		// compile time; note that constant expressions must access the elements through data[],
+		// as the subscript operators reinterpret it as vectors.
 		matrix() {}
-		matrix(std::initializer_list<T> initList)
+		constexpr matrix(std::initializer_list<T> initList): data()
 		{
 			int m = min(rows*cols, int(initList.size()));
 			auto iter = initList.begin();
@@ -35,35 +37,35 @@ namespace util
 			for (int i = m; i < rows*cols; ++i)
 				data[i] = T(0);
 		}
-		explicit matrix(T a)
+		constexpr explicit matrix(T a): data()
 		{
 			for (int i = 0; i < rows*cols; ++i)
 				data[i] = a;
 		}
 		template <typename U>
-		explicit matrix(const U * p)
+		constexpr explicit matrix(const U * p): data()
 		{
 			for (int i = 0; i < rows*cols; ++i)
 				data[i] = T(p[i]);
 		}
 		template <typename U, int rowsOther, int colsOther>
-		explicit matrix(matrix<U, rowsOther, colsOther> const & m)
+		constexpr explicit matrix(matrix<U, rowsOther, colsOther> const & m): data()
 		{
 			int r = min(rows, rowsOther);
 			int c = min(cols, colsOther);
 			for (int i = 0; i < r; ++i)
 			{
 				for (int j = 0; j < c; ++j)
-					(*this)[i][j] = T(m[i][j]);
+					data[i*cols + j] = T(m.data[i*colsOther + j]);
 				// Zero-fill any remaining cols
 				for (int j = c; j < cols; ++j)
-					(*this)[i][j] = T(0);
+					data[i*cols + j] = T(0);
 			}
 			// Zero-fill any remaining rows
 			for (int i = r*cols; i < rows*cols; ++i)
 				data[i] = T(0);
 		}
-		explicit matrix(identityTag)
+		constexpr explicit matrix(identityTag): data()
 		{
 			static_assert(rows == cols, "Can't construct identity for a non-square matrix");
 			for (int i = 0; i < rows*cols; ++i)
@@ -124,11 +126,14 @@ namespace util
 
 	// Overloaded math operators
 
+	// As with vectors, the componentwise operators are constexpr, and start from a copy of
+	// an operand rather than a default-constructed (uninitialized) result.
+
 #define DEFINE_UNARY_OPERATOR(op) \
 			template <typename T, int rows, int cols> \
-			matrix<T, rows, cols> operator op (matrix<T, rows, cols> const & a) \
+			constexpr matrix<T, rows, cols> operator op (matrix<T, rows, cols> const & a) \
 			{ \
-				matrix<T, rows, cols> result; \
+				matrix<T, rows, cols> result = a; \
 				for (int i = 0; i < rows*cols; ++i) \
 					result.data[i] = op a.data[i]; \
 				return result; \
@@ -137,18 +142,18 @@ namespace util
 #define DEFINE_BINARY_SCALAR_OPERATORS(op) \
 			/* Scalar-matrix op */ \
 			template <typename T, int rows, int cols> \
-			matrix<T, rows, cols> operator op (T a, matrix<T, rows, cols> const & b) \
+			constexpr matrix<T, rows, cols> operator op (T a, matrix<T, rows, cols> const & b) \
 			{ \
-				matrix<T, rows, cols> result; \
+				matrix<T, rows, cols> result = b; \
 				for (int i = 0; i < rows*cols; ++i) \
 					result.data[i] = a op b.data[i]; \
 				return result; \
 			} \
 			/* Matrix-scalar op */ \
 			template <typename T, int rows, int cols> \
-			matrix<T, rows, cols> operator op (matrix<T, rows, cols> const & a, T b) \
+			constexpr matrix<T, rows, cols> operator op (matrix<T, rows, cols> const & a, T b) \
 			{ \
-				matrix<T, rows, cols> result; \
+				matrix<T, rows, cols> result = a; \
 				for (int i = 0; i < rows*cols; ++i) \
 					result.data[i] = a.data[i] op b; \
 				return result; \
@@ -157,9 +162,9 @@ namespace util
 #define DEFINE_BINARY_OPERATORS(op) \
 			/* Matrix-matrix op */ \
 			template <typename T, int rows, int cols> \
-			matrix<T, rows, cols> operator op (matrix<T, rows, cols> const & a, matrix<T, rows, cols> const & b) \
+			constexpr matrix<T, rows, cols> operator op (matrix<T, rows, cols> const & a, matrix<T, rows, cols> const & b) \
 			{ \
-				matrix<T, rows, cols> result; \
+				matrix<T, rows, cols> result = a; \
 				for (int i = 0; i < rows*cols; ++i) \
 					result.data[i] = a.data[i] op b.data[i]; \
 				return result; \
@@ -169,7 +174,7 @@ namespace util
 #define DEFINE_INPLACE_SCALAR_OPERATOR(op) \
 			/* Matrix-scalar op */ \
 			template <typename T, int rows, int cols> \
-			matrix<T, rows, cols> & operator op (matrix<T, rows, cols> & a, T b) \
+			constexpr matrix<T, rows, cols> & operator op (matrix<T, rows, cols> & a, T b) \
 			{ \
 				for (int i = 0; i < rows*cols; ++i) \
 					a.data[i] op b; \
@@ -179,7 +184,7 @@ namespace util
 #define DEFINE_INPLACE_OPERATORS(op) \
 			/* Matrix-matrix op */ \
 			template <typename T, int rows, int cols> \
-			matrix<T, rows, cols> & operator op (matrix<T, rows, cols> & a, matrix<T, rows, cols> const & b) \
+			constexpr matrix<T, rows, cols> & operator op (matrix<T, rows, cols> & a, matrix<T, rows, cols> const & b) \
 			{ \
 				for (int i = 0; i < rows*cols; ++i) \
 					a.data[i] op b.data[i]; \
@@ -190,27 +195,27 @@ namespace util
 #define DEFINE_RELATIONAL_OPERATORS(op) \
 			/* Matrix-matrix op */ \
 			template <typename T, typename U, int rows, int cols> \
-			matrix<bool, rows, cols> operator op (matrix<T, rows, cols> const & a, matrix<U, rows, cols> const & b) \
+			matrix<decltype(T() op U()), rows, cols> operator op (matrix<T, rows, cols> const & a, matrix<U, rows, cols> const & b) \
 			{ \
-				matrix<bool, rows, cols> result; \
+				matrix<decltype(T() op U()), rows, cols> result; \
 				for (int i = 0; i < rows*cols; ++i) \
 					result.data[i] = a.data[i] op b.data[i]; \
 				return result; \
 			} \
 			/* Scalar-matrix op */ \
 			template <typename T, typename U, int rows, int cols> \
-			matrix<bool, rows, cols> operator op (T a, matrix<U, rows, cols> const & b) \
+			matrix<decltype(T() op U()), rows, cols> operator op (T a, matrix<U, rows, cols> const & b) \
 			{ \
-				matrix<bool, rows, cols> result; \
+				matrix<decltype(T() op U()), rows, cols> result; \
 				for (int i = 0; i < rows*cols; ++i) \
 					result.data[i] = a op b.data[i]; \
 				return result; \
 			} \
 			/* Matrix-scalar op */ \
 			template <typename T, typename U, int rows, int cols> \
-			matrix<bool, rows, cols> operator op (matrix<T, rows, cols> const & a, U b) \
+			matrix<decltype(T() op U()), rows, cols> operator op (matrix<T, rows, cols> const & a, U b) \
 			{ \
-				matrix<bool, rows, cols> result; \
+				matrix<decltype(T() op U()), rows, cols> result; \
 				for (int i = 0; i < rows*cols; ++i) \
 					result.data[i] = a.data[i] op b; \
 				return result; \
@@ -254,11 +259,46 @@ namespace util
 	template <typename T, int rows, int inner, int cols>
 	matrix<T, rows, cols> operator * (matrix<T, rows, inner> const & a, matrix<T, inner, cols> const & b)
 	{
-		matrix<T, rows, cols> result(T(0));
+		// Note: sums start from the first term rather than T(0), so these work for SIMD types too
+		matrix<T, rows, cols> result;
 		for (int i = 0; i < rows; ++i)
+		{
 			for (int j = 0; j < cols; ++j)
+			{
+				T sum = a[i][0] * b[0][j];
+				for (int k = 1; k < inner; ++k)
+					sum = fma(a[i][k], b[k][j], sum);
+				result[i][j] = sum;
+			}
+		}
+		return result;
+	}
+
+	// Matrix multiply-add, a*b + c, with the sums fused into each product
+	template <typename T, int rows, int inner, int cols>
+	matrix<T, rows, cols> fma(matrix<T, rows, inner> const & a, matrix<T, inner, cols> const & b, matrix<T, rows, cols> const & c)
+	{
+		matrix<T, rows, cols> result;
+		for (int i = 0; i < rows; ++i)
+		{
+			for (int j = 0; j < cols; ++j)
+			{
+				T sum = c[i][j];
 				for (int k = 0; k < inner; ++k)
-					result[i][j] += a[i][k] * b[k][j];
+					sum = fma(a[i][k], b[k][j], sum);
+				result[i][j] = sum;
+			}
+		}
+		return result;
+	}
+
+	// Componentwise fma with a scalar factor, e.g. for lerp
+	template <typename T, int rows, int cols>
+	matrix<T, rows, cols> fma(matrix<T, rows, cols> const & a, T b, matrix<T, rows, cols> const & c)
+	{
+		matrix<T, rows, cols> result;
+		for (int i = 0; i < rows*cols; ++i)
+			result.data[i] = fma(a.data[i], b, c.data[i]);
 		return result;
 	}
 
@@ -274,20 +314,19 @@ namespace util
 	template <typename T, int rows, int cols>
 	vector<T, rows> operator * (matrix<T, rows, cols> const & a, vector<T, cols> b)
 	{
-		vector<T, rows> result(T(0));
+		vector<T, rows> result;
 		for (int i = 0; i < rows; ++i)
-			for (int j = 0; j < cols; ++j)
-					result[i] += a[i][j] * b[j];
+			result[i] = dot(a[i], b);
 		return result;
 	}
 
 	template <typename T, int rows, int cols>
 	vector<T, cols> operator * (vector<T, rows> a, matrix<T, rows, cols> const & b)
 	{
-		vector<T, cols> result (T(0));
-		for (int i = 0; i < rows; ++i)
-			for (int j = 0; j < cols; ++j)
-					result[j] += a[i] * b[i][j];
+		// Accumulate rows of b, scaled by components of a
+		vector<T, cols> result = b[0] * a[0];
+		for (int i = 1; i < rows; ++i)
+			result = fma(b[i], a[i], result);
 		return result;
 	}
 
@@ -303,12 +342,13 @@ namespace util
 	// Other math functions
 
 	template <typename T, int rows, int cols>
-	matrix<T, cols, rows> transpose(matrix<T, rows, cols> const & a)
+	constexpr matrix<T, cols, rows> transpose(matrix<T, rows, cols> const & a)
 	{
-		matrix<T, cols, rows> result;
+		// Note: the result is initialized only so this can be constexpr
+		matrix<T, cols, rows> result(a.data[0]);
 		for (int i = 0; i < rows; ++i)
 			for (int j = 0; j < cols; ++j)
-				result[j][i] = a[i][j];
+				result.data[j*rows + i] = a.data[i*cols + j];
 		return result;
 	}
 
@@ -332,13 +372,23 @@ namespace util
 		return oddpart * evenpart;
 	}
 
+	// Invert a square matrix, returning false if it's singular.  The test is relative to the
+	// matrix's scale: it's singular if abs(det) <= epsilon times the product of the row lengths,
+	// which bounds abs(det) (Hadamard's inequality), so scaling a matrix doesn't change the
+	// outcome.  An epsilon of 0 skips the test.  The specializations for 2x2, 3x3 and 4x4 below,
+	// and the SSE float4x4 version, use the same test.
 	template <typename T, int n>
 	bool tryInvertMatrix(matrix<T, n, n> const & m, matrix<T, n, n> * pResultOut, float epsilon = util::epsilon)
 	{
-		// Calculate inverse using Gaussian elimination
+		// Calculate inverse using Gaussian elimination.  The determinant is the product of
+		// the pivots, up to sign.
 
 		matrix<T, n, n> a = m;
 		matrix<T, n, n> b(identity);
+		T det = T(1);
+		T rowLengthProduct = T(1);
+		for (int i = 0; i < n; ++i)
+			rowLengthProduct *= length(m[i]);
 
 		// Loop through columns
 		for (int j = 0; j < n; ++j)
@@ -349,9 +399,10 @@ namespace util
 				if (abs(a[i][j]) > abs(a[pivot][j]))
 					pivot = i;
 
-			// If we couldn't find a "sufficiently nonzero" element, the matrix is singular.
-			if (abs(a[pivot][j]) < epsilon)
+			// If the best pivot is zero, the matrix is singular.
+			if (epsilon > 0.0f && a[pivot][j] == T(0))
 				return false;
+			det *= a[pivot][j];
 
 			// Interchange rows to put pivot element on the diagonal,
 			// if it is not already there
@@ -373,7 +424,7 @@ namespace util
 			// Subtract this row from others to make the rest of column j zero
 			for (int i = 0; i < n; ++i)
 			{
-				if ((i != j) && (abs(a[i][j]) > epsilon))		// Skip rows with zero already in this column
+				if ((i != j) && (a[i][j] != T(0)))		// Skip rows with zero already in this column
 				{
 					T scale = -a[i][j];
 					a[i] += a[j] * scale;
@@ -382,6 +433,9 @@ namespace util
 			}
 		}
 	
+		if (epsilon > 0.0f && abs(det) <= epsilon * rowLengthProduct)
+			return false;
+
 		// At this point, a should have been transformed to the identity matrix,
 		// and b should have been transformed into the inverse of the original a.
 		if (pResultOut)
@@ -394,21 +448,91 @@ namespace util
 	bool tryInvertMatrix(matrix<T, 2, 2> const & a, matrix<T, 2, 2> * pResultOut, float epsilon = util::epsilon)
 	{
 		T det = (a[0][0]*a[1][1] - a[0][1]*a[1][0]);
-		if (abs(det) < epsilon)
+		if (epsilon > 0.0f && abs(det) <= epsilon * length(a[0]) * length(a[1]))
 			return false;
 		if (pResultOut)
 			*pResultOut = matrix<T, 2, 2>{ a[1][1], -a[0][1], -a[1][0], a[0][0] } / det;
 		return true;
 	}
 
-	// !!!UNDONE: inverse specialization for 3x3? worth it?
+	// Inverse specialization for 3x3: the columns of the inverse are cross products of the rows
+	template <typename T>
+	bool tryInvertMatrix(matrix<T, 3, 3> const & a, matrix<T, 3, 3> * pResultOut, float epsilon = util::epsilon)
+	{
+		vector<T, 3> col0 = cross(a[1], a[2]);
+		T det = dot(a[0], col0);
+		if (epsilon > 0.0f && abs(det) <= epsilon * length(a[0]) * length(a[1]) * length(a[2]))
+			return false;
+		if (pResultOut)
+			*pResultOut = matrixFromCols(col0, cross(a[2], a[0]), cross(a[0], a[1])) / det;
+		return true;
+	}
+
+	// Adjugate (transposed cofactor matrix) of a 4x4, by cofactor expansion.  The cofactors are
+	// built from the 2x2 minors of the top two rows (s) and the bottom two rows (c), which are
+	// shared between many of them (see Eberly, "The Laplace Expansion Theorem").  The determinant
+	// falls out of the same minors, so it's returned as well.  This has no branches, so it
+	// works lane-wise for SIMD types too.
+	template <typename T>
+	matrix<T, 4, 4> adjugate(matrix<T, 4, 4> const & a, T * pDeterminantOut)
+	{
+		T s0 = a[0][0]*a[1][1] - a[1][0]*a[0][1];
+		T s1 = a[0][0]*a[1][2] - a[1][0]*a[0][2];
+		T s2 = a[0][0]*a[1][3] - a[1][0]*a[0][3];
+		T s3 = a[0][1]*a[1][2] - a[1][1]*a[0][2];
+		T s4 = a[0][1]*a[1][3] - a[1][1]*a[0][3];
+		T s5 = a[0][2]*a[1][3] - a[1][2]*a[0][3];
+		T c0 = a[2][0]*a[3][1] - a[3][0]*a[2][1];
+		T c1 = a[2][0]*a[3][2] - a[3][0]*a[2][2];
+		T c2 = a[2][0]*a[3][3] - a[3][0]*a[2][3];
+		T c3 = a[2][1]*a[3][2] - a[3][1]*a[2][2];
+		T c4 = a[2][1]*a[3][3] - a[3][1]*a[2][3];
+		T c5 = a[2][2]*a[3][3] - a[3][2]*a[2][3];
+		if (pDeterminantOut)
+			*pDeterminantOut = s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+
+		matrix<T, 4, 4> result;
+		result[0][0] =  a[1][1]*c5 - a[1][2]*c4 + a[1][3]*c3;
+		result[0][1] = -a[0][1]*c5 + a[0][2]*c4 - a[0][3]*c3;
+		result[0][2] =  a[3][1]*s5 - a[3][2]*s4 + a[3][3]*s3;
+		result[0][3] = -a[2][1]*s5 + a[2][2]*s4 - a[2][3]*s3;
+
+		result[1][0] = -a[1][0]*c5 + a[1][2]*c2 - a[1][3]*c1;
+		result[1][1] =  a[0][0]*c5 - a[0][2]*c2 + a[0][3]*c1;
+		result[1][2] = -a[3][0]*s5 + a[3][2]*s2 - a[3][3]*s1;
+		result[1][3] =  a[2][0]*s5 - a[2][2]*s2 + a[2][3]*s1;
+
+		result[2][0] =  a[1][0]*c4 - a[1][1]*c2 + a[1][3]*c0;
+		result[2][1] = -a[0][0]*c4 + a[0][1]*c2 - a[0][3]*c0;
+		result[2][2] =  a[3][0]*s4 - a[3][1]*s2 + a[3][3]*s0;
+		result[2][3] = -a[2][0]*s4 + a[2][1]*s2 - a[2][3]*s0;
+
+		result[3][0] = -a[1][0]*c3 + a[1][1]*c1 - a[1][2]*c0;
+		result[3][1] =  a[0][0]*c3 - a[0][1]*c1 + a[0][2]*c0;
+		result[3][2] = -a[3][0]*s3 + a[3][1]*s1 - a[3][2]*s0;
+		result[3][3] =  a[2][0]*s3 - a[2][1]*s1 + a[2][2]*s0;
+		return result;
+	}
+
+	// Inverse specialization for 4x4, via the adjugate
+	template <typename T>
+	bool tryInvertMatrix(matrix<T, 4, 4> const & a, matrix<T, 4, 4> * pResultOut, float epsilon = util::epsilon)
+	{
+		T det;
+		matrix<T, 4, 4> adj = adjugate(a, &det);
+		if (epsilon > 0.0f && abs(det) <= epsilon * length(a[0]) * length(a[1]) * length(a[2]) * length(a[3]))
+			return false;
+		if (pResultOut)
+			*pResultOut = adj * (T(1) / det);
+		return true;
+	}
 
 	// Inverse routine that doesn't check for singularity, assumes You Know What You're Doing(TM)
 	template <typename T, int n>
 	matrix<T, n, n> inverse(matrix<T, n, n> const & a)
 	{
 		matrix<T, n, n> result;
-		(void) tryInvertMatrix(a, &result);
+		(void) tryInvertMatrix(a, &result, 0.0f);
 		return result;
 	}
 
@@ -420,7 +544,22 @@ namespace util
 		return matrix<T, 2, 2>{ a[1][1], -a[0][1], -a[1][0], a[0][0] } / det;
 	}
 
-	// !!!UNDONE: inverse specialization for 3x3? worth it?
+	// Inverse specializations for 3x3 and 4x4, as in tryInvertMatrix but without the test
+	template <typename T>
+	matrix<T, 3, 3> inverse(matrix<T, 3, 3> const & a)
+	{
+		vector<T, 3> col0 = cross(a[1], a[2]);
+		T det = dot(a[0], col0);
+		return matrixFromCols(col0, cross(a[2], a[0]), cross(a[0], a[1])) / det;
+	}
+
+	template <typename T>
+	matrix<T, 4, 4> inverse(matrix<T, 4, 4> const & a)
+	{
+		T det;
+		matrix<T, 4, 4> adj = adjugate(a, &det);
+		return adj * (splat<T>(1.0f) / det);
+	}
 
 	template <typename T, int n>
 	T determinant(matrix<T, n, n> const & m, float epsilon = util::epsilon)
@@ -483,7 +622,31 @@ namespace util
 		return (a[0][0]*a[1][1] - a[0][1]*a[1][0]);
 	}
 
-	// !!!UNDONE: determinant specialization for 3x3? worth it?
+	// Determinant specialization for 3x3: the scalar triple product of the rows
+	template <typename T>
+	T determinant(matrix<T, 3, 3> const & a, float /*epsilon*/ = util::epsilon)
+	{
+		return dot(a[0], cross(a[1], a[2]));
+	}
+
+	// Determinant specialization for 4x4, by cofactor expansion (see adjugate above)
+	template <typename T>
+	T determinant(matrix<T, 4, 4> const & a, float /*epsilon*/ = util::epsilon)
+	{
+		T s0 = a[0][0]*a[1][1] - a[1][0]*a[0][1];
+		T s1 = a[0][0]*a[1][2] - a[1][0]*a[0][2];
+		T s2 = a[0][0]*a[1][3] - a[1][0]*a[0][3];
+		T s3 = a[0][1]*a[1][2] - a[1][1]*a[0][2];
+		T s4 = a[0][1]*a[1][3] - a[1][1]*a[0][3];
+		T s5 = a[0][2]*a[1][3] - a[1][2]*a[0][3];
+		T c0 = a[2][0]*a[3][1] - a[3][0]*a[2][1];
+		T c1 = a[2][0]*a[3][2] - a[3][0]*a[2][2];
+		T c2 = a[2][0]*a[3][3] - a[3][0]*a[2][3];
+		T c3 = a[2][1]*a[3][2] - a[3][1]*a[2][2];
+		T c4 = a[2][1]*a[3][3] - a[3][1]*a[2][3];
+		T c5 = a[2][2]*a[3][3] - a[3][2]*a[2][3];
+		return s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+	}
 
 	template <typename T, int n>
 	T trace(matrix<T, n, n> const & a)
@@ -494,26 +657,326 @@ namespace util
 		return result;
 	}
 
-	// !!!UNDONE: diagonalization and decomposition?
+	// LU decomposition with partial pivoting: PA = LU.  For solving A x = b against the same
+	// matrix many times, factor it once and call solve() for each right-hand side; that's
+	// cheaper than finding the inverse, and more accurate than multiplying by it.
+	// L (unit lower triangular) and U are packed together in one matrix, and the row
+	// permutation P is stored as the original index of each row.
+	template <typename T, int n>
+	struct luDecomposition
+	{
+		matrix<T, n, n>	lu;			// L below the diagonal (its diagonal is implicitly all 1s), U on and above
+		int				perm[n];	// Row i of LU corresponds to row perm[i] of A
+		bool			oddPerm;	// Whether P is an odd permutation, i.e. negates the determinant
+
+		// Solve A x = b for x
+		vector<T, n> solve(vector<T, n> b) const
+		{
+			// Permute b, then forward-substitute through L
+			vector<T, n> x;
+			for (int i = 0; i < n; ++i)
+			{
+				x[i] = b[perm[i]];
+				for (int k = 0; k < i; ++k)
+					x[i] -= lu[i][k] * x[k];
+			}
+			// Back-substitute through U
+			for (int i = n-1; i >= 0; --i)
+			{
+				for (int k = i+1; k < n; ++k)
+					x[i] -= lu[i][k] * x[k];
+				x[i] /= lu[i][i];
+			}
+			return x;
+		}
+
+		// Solve A X = B for X, with one right-hand side per column of B.  The substitutions
+		// work on whole rows of B at a time.
+		template <int cols>
+		matrix<T, n, cols> solve(matrix<T, n, cols> const & b) const
+		{
+			matrix<T, n, cols> x;
+			for (int i = 0; i < n; ++i)
+			{
+				x[i] = b[perm[i]];
+				for (int k = 0; k < i; ++k)
+					x[i] -= x[k] * lu[i][k];
+			}
+			for (int i = n-1; i >= 0; --i)
+			{
+				for (int k = i+1; k < n; ++k)
+					x[i] -= x[k] * lu[i][k];
+				x[i] /= lu[i][i];
+			}
+			return x;
+		}
+
+		// Determinant of A: the product of U's diagonal, negated for an odd permutation
+		T determinant() const
+		{
+			T result = lu[0][0];
+			for (int i = 1; i < n; ++i)
+				result *= lu[i][i];
+			return oddPerm ? -result : result;
+		}
+
+		matrix<T, n, n> inverse() const
+			{ return solve(matrix<T, n, n>(identity)); }
+	};
+
+	// Factor a into *pResultOut.  Fails if the matrix is singular, i.e. if no pivot element
+	// of magnitude at least epsilon can be found for some column.
+	template <typename T, int n>
+	bool tryDecomposeLU(matrix<T, n, n> const & a, luDecomposition<T, n> * pResultOut, float epsilon = util::epsilon)
+	{
+		matrix<T, n, n> & lu = pResultOut->lu;
+		lu = a;
+		for (int i = 0; i < n; ++i)
+			pResultOut->perm[i] = i;
+		pResultOut->oddPerm = false;
+
+		// Loop through columns
+		for (int j = 0; j < n; ++j)
+		{
+			// Select pivot element: maximum magnitude in this column at or below main diagonal
+			int pivot = j;
+			for (int i = j+1; i < n; ++i)
+				if (abs(lu[i][j]) > abs(lu[pivot][j]))
+					pivot = i;
+
+			// If we couldn't find a "sufficiently nonzero" element, the matrix is singular.
+			if (abs(lu[pivot][j]) < epsilon)
+				return false;
+
+			// Interchange rows to put pivot element on the diagonal,
+			// if it is not already there
+			if (pivot != j)
+			{
+				swap(lu[j], lu[pivot]);
+				swap(pResultOut->perm[j], pResultOut->perm[pivot]);
+				pResultOut->oddPerm = !pResultOut->oddPerm;
+			}
+
+			// Eliminate column j below the diagonal, storing the multipliers there to form L
+			T rcpPivot = T(1) / lu[j][j];
+			for (int i = j+1; i < n; ++i)
+			{
+				T l = lu[i][j] * rcpPivot;
+				lu[i][j] = l;
+				for (int k = j+1; k < n; ++k)
+					lu[i][k] -= l * lu[j][k];
+			}
+		}
+
+		return true;
+	}
+
+	namespace impl
+	{
+		// One Jacobi rotation in the (p, q) plane, chosen to zero apq.  arp and arq are the
+		// elements pairing p and q with the remaining index r; vp and vq are the eigenvectors
+		// accumulated so far.  Branch-free, so it works on SIMD lanes.
+		template <typename T>
+		void jacobiRotate(T & app, T & aqq, T & apq, T & arp, T & arq, vector<T, 3> & vp, vector<T, 3> & vq)
+		{
+			// Flush apq to zero once it's negligible next to the diagonal, as squaring it
+			// would otherwise make denormals, which are very slow
+			T absTau = abs(aqq - app);
+			apq = select(abs(apq) < splat<T>(1e-12f) * (abs(app) + abs(aqq)), splat<T>(0.0f), apq);
+
+			// The rotation angle has tan = t = sign(aqq - app) * 2 apq / (|aqq - app| + h),
+			// with h = sqrt((aqq - app)^2 + 4 apq^2).  Its cosine and sine come out as below,
+			// needing just one reciprocal; when h = 0, it's the identity.
+			T h = sqrt(absTau*absTau + splat<T>(4.0f)*apq*apq);
+			T g = sqrt(splat<T>(2.0f)*h*(h + absTau));
+			T rcpG = splat<T>(1.0f) / max(g, splat<T>(FLT_MIN));
+			auto tauNegative = aqq < app;
+			T c = select(g > splat<T>(0.0f), (h + absTau) * rcpG, splat<T>(1.0f));
+			T s = splat<T>(2.0f)*apq*rcpG;
+			s = select(tauNegative, -s, s);
+
+			// Update the diagonal: t*apq works out to sign(aqq - app) * (h - |aqq - app|) / 2
+			T delta = splat<T>(0.5f)*(h - absTau);
+			delta = select(tauNegative, -delta, delta);
+			app -= delta;
+			aqq += delta;
+			apq = splat<T>(0.0f);
+
+			T rp = arp;
+			arp = c*rp - s*arq;
+			arq = s*rp + c*arq;
+			vector<T, 3> wp = vp;
+			vp = wp*c - vq*s;
+			vq = wp*s + vq*c;
+		}
+
+		// Compare-and-swap eigenpairs so that di <= dj
+		template <typename T>
+		void sortEigenpair(T & di, T & dj, vector<T, 3> & vi, vector<T, 3> & vj)
+		{
+			typedef decltype(di < dj) M;
+			M swapMask = dj < di;
+			T d = di;
+			di = select(swapMask, dj, di);
+			dj = select(swapMask, d, dj);
+			vector<T, 3> v = vi;
+			vi = select(vector<M, 3>(swapMask), vj, vi);
+			vj = select(vector<M, 3>(swapMask), v, vj);
+		}
+	}
+
+	// Eigendecomposition of a symmetric 3x3 matrix, by cyclic Jacobi rotations.  Finds the
+	// eigenvalues, in increasing order, and orthonormal eigenvectors as the rows of a matrix V,
+	// so that a = transpose(V) * diagonalMatrix(eigenvalues) * V.  (E.g. for normal estimation
+	// from a covariance matrix, the normal is row 0.)  Only the upper triangle of a is read.
+	// This runs a fixed number of sweeps, each rotating away the three off-diagonal elements
+	// in turn, with no branches; so it also runs lane-parallel on SIMD types, e.g.
+	// matrix<__m128, 3, 3> for 4 matrices at a time.  Four sweeps reach float precision
+	// for typical matrices.
+	template <typename T>
+	void eigenDecomposeSymmetric(
+		matrix<T, 3, 3> const & a,
+		vector<T, 3> * pEigenvaluesOut,
+		matrix<T, 3, 3> * pEigenvectorsOut,
+		int numSweeps = 4)
+	{
+		T a00 = a[0][0], a11 = a[1][1], a22 = a[2][2];
+		T a01 = a[0][1], a02 = a[0][2], a12 = a[1][2];
+		T zero = splat<T>(0.0f), one = splat<T>(1.0f);
+		vector<T, 3> v0(one, zero, zero);
+		vector<T, 3> v1(zero, one, zero);
+		vector<T, 3> v2(zero, zero, one);
+
+		for (int sweep = 0; sweep < numSweeps; ++sweep)
+		{
+			impl::jacobiRotate(a00, a11, a01, a02, a12, v0, v1);
+			impl::jacobiRotate(a00, a22, a02, a01, a12, v0, v2);
+			impl::jacobiRotate(a11, a22, a12, a01, a02, v1, v2);
+		}
+
+		impl::sortEigenpair(a00, a11, v0, v1);
+		impl::sortEigenpair(a11, a22, v1, v2);
+		impl::sortEigenpair(a00, a11, v0, v1);
+
+		if (pEigenvaluesOut)
+			*pEigenvaluesOut = vector<T, 3>(a00, a11, a22);
+		if (pEigenvectorsOut)
+		{
+			(*pEigenvectorsOut)[0] = v0;
+			(*pEigenvectorsOut)[1] = v1;
+			(*pEigenvectorsOut)[2] = v2;
+		}
+	}
+
+	namespace impl
+	{
+		// Givens rotation of rows p and q of b, chosen to zero b[q][col] against b[p][col]
+		// (leaving b[p][col] non-negative).  The same rotation is applied to the rows of m,
+		// to accumulate the product of the rotations.
+		template <typename T>
+		void givensRows(matrix<T, 3, 3> & b, matrix<T, 3, 3> & m, int p, int q, int col)
+		{
+			T x = b[p][col], y = b[q][col];
+			T r = sqrt(x*x + y*y);
+			T rcpR = splat<T>(1.0f) / max(r, splat<T>(FLT_MIN));
+			T c = select(r > splat<T>(0.0f), x * rcpR, splat<T>(1.0f));
+			T s = y * rcpR;
+			vector<T, 3> bp = b[p], mp = m[p];
+			b[p] = bp*c + b[q]*s;
+			b[q] = b[q]*c - bp*s;
+			m[p] = mp*c + m[q]*s;
+			m[q] = m[q]*c - mp*s;
+		}
+	}
+
+	// Singular value decomposition of a 3x3 matrix, a = u * diagonalMatrix(sigma) * transpose(v),
+	// with u and v rotations (determinant +1).  The singular values are in decreasing order of
+	// magnitude, and if det(a) < 0, sigma.z comes out negative, rather than u or v including
+	// a reflection; this is the form wanted for deformation gradients, e.g. in shape matching.
+	// Following McAdams et al., "Computing the Singular Value Decomposition of 3x3 matrices with
+	// minimal branching and elementary floating point operations" (2011): v comes from the
+	// eigenvectors of transpose(a) * a, then a QR factorization of a * v by Givens rotations
+	// gives u and sigma.  (The eigenvectors use the exact Jacobi rotations above, rather than the
+	// paper's approximate quaternion ones.)  Branch-free, so it also works on SIMD lanes.
+	template <typename T>
+	void decomposeSVD(
+		matrix<T, 3, 3> const & a,
+		matrix<T, 3, 3> * pUOut,
+		vector<T, 3> * pSigmaOut,
+		matrix<T, 3, 3> * pVOut)
+	{
+		// Eigenvectors of a^T a, as the rows of vt, in order of decreasing eigenvalue,
+		// flipping the last one if needed to make v a rotation
+		vector<T, 3> eigenvalues;
+		matrix<T, 3, 3> e;
+		eigenDecomposeSymmetric(transpose(a) * a, &eigenvalues, &e);
+		matrix<T, 3, 3> vt;
+		vt[0] = e[2];
+		vt[1] = e[1];
+		vt[2] = e[0];
+		T det = dot(cross(vt[0], vt[1]), vt[2]);
+		vt[2] = select(vector<decltype(det < det), 3>(det < splat<T>(0.0f)), -vt[2], vt[2]);
+
+		// QR factorization of b = a v, by Givens rotations that zero the subdiagonal.  The
+		// columns of b are already orthogonal, so r comes out diagonal, with sigma on it.
+		matrix<T, 3, 3> b = a * transpose(vt);
+		T zero = splat<T>(0.0f), one = splat<T>(1.0f);
+		matrix<T, 3, 3> q;
+		q[0] = vector<T, 3>(one, zero, zero);
+		q[1] = vector<T, 3>(zero, one, zero);
+		q[2] = vector<T, 3>(zero, zero, one);
+		impl::givensRows(b, q, 0, 1, 0);
+		impl::givensRows(b, q, 0, 2, 0);
+		impl::givensRows(b, q, 1, 2, 1);
+
+		// Now q b_original = r, so u = transpose(q)
+		if (pUOut)
+			*pUOut = transpose(q);
+		if (pSigmaOut)
+			*pSigmaOut = vector<T, 3>(b[0][0], b[1][1], b[2][2]);
+		if (pVOut)
+			*pVOut = transpose(vt);
+	}
+
+	// Polar decomposition of a 3x3 matrix, a = rotation * stretch, with stretch symmetric.
+	// Via the SVD, so if det(a) < 0 the reflection ends up in stretch, and rotation is always
+	// a proper rotation.  There's also a version returning the rotation as a quat, in util-quat.h.
+	template <typename T>
+	void polarDecompose(matrix<T, 3, 3> const & a, matrix<T, 3, 3> * pRotationOut, matrix<T, 3, 3> * pStretchOut)
+	{
+		matrix<T, 3, 3> u, v;
+		vector<T, 3> sigma;
+		decomposeSVD(a, &u, &sigma, &v);
+		matrix<T, 3, 3> vt = transpose(v);
+		if (pRotationOut)
+			*pRotationOut = u * vt;
+		if (pStretchOut)
+		{
+			// v * diagonalMatrix(sigma) * vt, i.e. the columns of v scaled by sigma, times vt
+			for (int i = 0; i < 3; ++i)
+				v[i] *= sigma;
+			*pStretchOut = v * vt;
+		}
+	}
 
 	template <typename T, int n>
-	matrix<T, n, n> diagonalMatrix(T a)
+	constexpr matrix<T, n, n> diagonalMatrix(T a)
 	{
 		matrix<T, n, n> result(T(0));
 		for (int i = 0; i < n; ++i)
-			result[i][i] = a;
+			result.data[i*(n+1)] = a;
 		return result;
 	}
 	template <typename T, int n>
-	matrix<T, n, n> diagonalMatrix(vector<T, n> a)
+	constexpr matrix<T, n, n> diagonalMatrix(vector<T, n> a)
 	{
 		matrix<T, n, n> result(T(0));
 		for (int i = 0; i < n; ++i)
-			result[i][i] = a[i];
+			result.data[i*(n+1)] = a[i];
 		return result;
 	}
 	template <typename T, typename... Ts>
-	matrix<T, 1+sizeof...(Ts), 1+sizeof...(Ts)> diagonalMatrix(T first, Ts... rest)
+	constexpr matrix<T, 1+sizeof...(Ts), 1+sizeof...(Ts)> diagonalMatrix(T first, Ts... rest)
 	{
 		return diagonalMatrix(vector<T, 1+sizeof...(Ts)>{first, rest...});
 	}
@@ -572,51 +1035,52 @@ namespace util
 
 
 
-	// Utilities for bool matrices
+	// Utilities for bool matrices.  As with vectors, these also work per-lane for
+	// matrices of SIMD masks.
 
 	// Any: checks if any of the values of a bool matrix is true, i.e. ORs them together.
-	template <int rows, int cols>
-	bool any(matrix<bool, rows, cols> const & a)
+	template <typename M, int rows, int cols>
+	M any(matrix<M, rows, cols> const & a)
 	{
-		bool result = a.data[0];
+		M result = a.data[0];
 		for (int i = 1; i < rows*cols; ++i)
 			result |= a.data[i];
 		return result;
 	}
 
 	// All: checks if all of the values of a bool matrix are true, i.e. ANDs them together.
-	template <int rows, int cols>
-	bool all(matrix<bool, rows, cols> const & a)
+	template <typename M, int rows, int cols>
+	M all(matrix<M, rows, cols> const & a)
 	{
-		bool result = a.data[0];
+		M result = a.data[0];
 		for (int i = 1; i < rows*cols; ++i)
 			result &= a.data[i];
 		return result;
 	}
 
 	// Select: ternary operator for matrices. Selects componentwise from a or b based on cond.
-	template <typename T, int rows, int cols>
-	matrix<T, rows, cols> select(matrix<bool, rows, cols> const & cond, matrix<T, rows, cols> const & a, matrix<T, rows, cols> const & b)
+	template <typename M, typename T, int rows, int cols>
+	matrix<T, rows, cols> select(matrix<M, rows, cols> const & cond, matrix<T, rows, cols> const & a, matrix<T, rows, cols> const & b)
 	{
 		matrix<T, rows, cols> result;
 		for (int i = 0; i < rows*cols; ++i)
-			result.data[i] = cond.data[i] ? a.data[i] : b.data[i];
+			result.data[i] = select(cond.data[i], a.data[i], b.data[i]);
 		return result;
 	}
-	template <typename T, int rows, int cols>
-	matrix<T, rows, cols> select(matrix<bool, rows, cols> const & cond, T a, matrix<T, rows, cols> const & b)
+	template <typename M, typename T, int rows, int cols>
+	matrix<T, rows, cols> select(matrix<M, rows, cols> const & cond, T a, matrix<T, rows, cols> const & b)
 	{
 		matrix<T, rows, cols> result;
 		for (int i = 0; i < rows*cols; ++i)
-			result.data[i] = cond.data[i] ? a : b.data[i];
+			result.data[i] = select(cond.data[i], a, b.data[i]);
 		return result;
 	}
-	template <typename T, int rows, int cols>
-	matrix<T, rows, cols> select(matrix<bool, rows, cols> const & cond, matrix<T, rows, cols> const & a, T b)
+	template <typename M, typename T, int rows, int cols>
+	matrix<T, rows, cols> select(matrix<M, rows, cols> const & cond, matrix<T, rows, cols> const & a, T b)
 	{
 		matrix<T, rows, cols> result;
 		for (int i = 0; i < rows*cols; ++i)
-			result.data[i] = cond.data[i] ? a.data[i] : b;
+			result.data[i] = select(cond.data[i], a.data[i], b);
 		return result;
 	}
 
@@ -642,7 +1106,12 @@ namespace util
 
 	template <typename T, int rows, int cols>
 	matrix<T, rows, cols> abs(matrix<T, rows, cols> const & a)
-		{ return select(a < T(0), -a, a); }
+	{
+		matrix<T, rows, cols> result;
+		for (int i = 0; i < rows*cols; ++i)
+			result.data[i] = abs(a.data[i]);
+		return result;
+	}
 
 	template <typename T, int rows, int cols>
 	matrix<T, rows, cols> clamp(matrix<T, rows, cols> const & value, T lower, T upper)
@@ -650,7 +1119,7 @@ namespace util
 
 	template <typename T, int rows, int cols>
 	matrix<T, rows, cols> saturate(matrix<T, rows, cols> const & value)
-		{ return clamp(value, T(0), T(1)); }
+		{ return clamp(value, splat<T>(0.0f), splat<T>(1.0f)); }
 
 	template <typename T, int rows, int cols>
 	T minComponent(matrix<T, rows, cols> const & a)
@@ -736,25 +1205,27 @@ namespace util
 	template <typename T, int rows, int cols>
 	vector<T, cols-1> xfmPoint(vector<T, rows-1> a, matrix<T, rows, cols> const & b)
 	{
-		vector<T, cols-1> result(T(0));
+		vector<T, cols-1> result;
+		// Translation part
+		for (int j = 0; j < cols-1; ++j)
+			result[j] = b[rows-1][j];
 		// Linear part
 		for (int i = 0; i < rows-1; ++i)
 			for (int j = 0; j < cols-1; ++j)
-					result[j] += a[i] * b[i][j];
-		// Translation part
-		for (int j = 0; j < cols-1; ++j)
-			result[j] += b[rows-1][j];
+					result[j] = fma(a[i], b[i][j], result[j]);
 		return result;
 	}
 
 	template <typename T, int rows, int cols>
 	vector<T, cols-1> xfmVector(vector<T, rows-1> a, matrix<T, rows, cols> const & b)
 	{
-		vector<T, cols-1> result(T(0));
+		vector<T, cols-1> result;
+		for (int j = 0; j < cols-1; ++j)
+			result[j] = a[0] * b[0][j];
 		// Linear part
-		for (int i = 0; i < rows-1; ++i)
+		for (int i = 1; i < rows-1; ++i)
 			for (int j = 0; j < cols-1; ++j)
-					result[j] += a[i] * b[i][j];
+					result[j] = fma(a[i], b[i][j], result[j]);
 		// No translation for vectors!
 		return result;
 	}
@@ -46,4 +46,12 @@ namespace util
 		result.z = copysignf(result.z, a[0][1] - a[1][0]);
 		return result;
 	}
+
+	void polarDecompose(float3x3 const & a, quat * pRotationOut, float3x3 * pStretchOut)
+	{
+		float3x3 rotation;
+		polarDecompose(a, &rotation, pStretchOut);
+		if (pRotationOut)
+			*pRotationOut = quatFromRotationMatrix(rotation);
+	}
 }
@@ -14,12 +14,13 @@ namespace util
 		};
 
 		// Subscript accessors
-		      float & operator [] (int i)       { return data[i]; }
-		const float & operator [] (int i) const { return data[i]; }
+		constexpr       float & operator [] (int i)       { return data[i]; }
+		constexpr const float & operator [] (int i) const { return data[i]; }
 
-		// Constructors
+		// Constructors.  As with vectors, all but the default one are constexpr and initialize
+		// the data array, so constant expressions should access the components through it.
 		quat() {}
-		quat(std::initializer_list<float> initList)
+		constexpr quat(std::initializer_list<float> initList): data()
 		{
 			int m = min(4, int(initList.size()));
 			auto iter = initList.begin();
@@ -32,24 +33,24 @@ namespace util
 			for (int i = m; i < 4; ++i)
 				data[i] = 0.0f;
 		}
-		explicit quat(float a)
+		constexpr explicit quat(float a): data()
 		{
 			for (int i = 0; i < 4; ++i)
 				data[i] = a;
 		}
-		explicit quat(const float * p)
+		constexpr explicit quat(const float * p): data()
 		{
 			for (int i = 0; i < 4; ++i)
 				data[i] = p[i];
 		}
-		quat(float w_, float x_, float y_, float z_)
-			{ w = w_; x = x_; y = y_; z = z_; }
-		quat(float w_, float3 xyz)
-			{ w = w_; x = xyz.x; y = xyz.y; z = xyz.z; }
-		explicit quat(float4 xyzw)
-			{ w = xyzw.w; x = xyzw.x; y = xyzw.y; z = xyzw.z; }
-		explicit quat(identityTag)
-			{ w = 1.0f; x = 0.0f; y = 0.0f; z = 0.0f; }
+		constexpr quat(float w_, float x_, float y_, float z_)
+			: data{w_, x_, y_, z_} {}
+		constexpr quat(float w_, float3 xyz)
+			: data{w_, xyz[0], xyz[1], xyz[2]} {}
+		constexpr explicit quat(float4 xyzw)
+			: data{xyzw[3], xyzw[0], xyzw[1], xyzw[2]} {}
+		constexpr explicit quat(identityTag)
+			: data{1.0f, 0.0f, 0.0f, 0.0f} {}
 
 		// C array conversions
 		typedef float (&array_t)[4];
@@ -67,47 +68,45 @@ namespace util
 
 	// Overloaded math operators
 
+	// As with vectors, these are constexpr and work on their by-value arguments in place
+
 #define DEFINE_UNARY_OPERATOR(op) \
-			inline quat operator op (quat a) \
+			constexpr quat operator op (quat a) \
 			{ \
-				quat result; \
 				for (int i = 0; i < 4; ++i) \
-					result[i] = op a[i]; \
-				return result; \
+					a.data[i] = op a.data[i]; \
+				return a; \
 			}
 
 #define DEFINE_BINARY_SCALAR_OPERATORS(op) \
 			/* Scalar-quat op */ \
-			inline quat operator op (float a, quat b) \
+			constexpr quat operator op (float a, quat b) \
 			{ \
-				quat result; \
 				for (int i = 0; i < 4; ++i) \
-					result.data[i] = a op b.data[i]; \
-				return result; \
+					b.data[i] = a op b.data[i]; \
+				return b; \
 			} \
 			/* Quat-scalar op */ \
-			inline quat operator op (quat a, float b) \
+			constexpr quat operator op (quat a, float b) \
 			{ \
-				quat result; \
 				for (int i = 0; i < 4; ++i) \
-					result.data[i] = a.data[i] op b; \
-				return result; \
+					a.data[i] = a.data[i] op b; \
+				return a; \
 			}
 
 #define DEFINE_BINARY_OPERATORS(op) \
 			/* Quat-quat op */ \
-			inline quat operator op (quat a, quat b) \
+			constexpr quat operator op (quat a, quat b) \
 			{ \
-				quat result; \
 				for (int i = 0; i < 4; ++i) \
-					result.data[i] = a.data[i] op b.data[i]; \
-				return result; \
+					a.data[i] = a.data[i] op b.data[i]; \
+				return a; \
 			} \
 			DEFINE_BINARY_SCALAR_OPERATORS(op)
 
 #define DEFINE_INPLACE_SCALAR_OPERATOR(op) \
 			/* Quat-scalar op */ \
-			inline quat & operator op (quat & a, float b) \
+			constexpr quat & operator op (quat & a, float b) \
 			{ \
 				for (int i = 0; i < 4; ++i) \
 					a.data[i] op b; \
@@ -116,7 +115,7 @@ namespace util
 
 #define DEFINE_INPLACE_OPERATORS(op) \
 			/* Quat-quat op */ \
-			inline quat & operator op (quat & a, quat b) \
+			constexpr quat & operator op (quat & a, quat b) \
 			{ \
 				for (int i = 0; i < 4; ++i) \
 					a.data[i] op b.data[i]; \
@@ -173,23 +172,43 @@ namespace util
 #undef DEFINE_INPLACE_OPERATORS
 #undef DEFINE_RELATIONAL_OPERATORS
 
-	// Quaternion multiplication
-	inline quat operator * (quat a, quat b)
+	// Quaternion multiplication.  Components are indexed as data[0..3] = w, x, y, z.
+	constexpr quat operator * (quat a, quat b)
 	{
 		return
 		{
-			a.w*b.w - a.x*b.x - a.y*b.y - a.z*b.z,
-			a.w*b.x + a.x*b.w + a.y*b.z - a.z*b.y,
-			a.w*b.y + a.y*b.w + a.z*b.x - a.x*b.z,
-			a.w*b.z + a.z*b.w + a.x*b.y - a.y*b.x,
+			a[0]*b[0] - a[1]*b[1] - a[2]*b[2] - a[3]*b[3],
+			a[0]*b[1] + a[1]*b[0] + a[2]*b[3] - a[3]*b[2],
+			a[0]*b[2] + a[2]*b[0] + a[3]*b[1] - a[1]*b[3],
+			a[0]*b[3] + a[3]*b[0] + a[1]*b[2] - a[2]*b[1],
 		};
 	}
-	inline quat & operator *= (quat & a, quat b)
+	constexpr quat & operator *= (quat & a, quat b)
 	{
 		a = a*b;
 		return a;
 	}
 
+	// The same product with SSE, for runtime use where it's hot (e.g. composing many rotations).
+	// The operator above stays constexpr.  The product is
+	//   a.w * (b.w, b.x, b.y, b.z) + a.x * (-b.x, b.w, -b.z, b.y) +
+	//   a.y * (-b.y, b.z, b.w, -b.x) + a.z * (-b.z, -b.y, b.x, b.w)
+	// so each term is a broadcast component of a times a shuffle of b, with signs flipped.
+	inline quat quatProductSSE(quat a, quat b)
+	{
+		__m128 va = _mm_loadu_ps(a.data);
+		__m128 vb = _mm_loadu_ps(b.data);
+		__m128 bx = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(2, 3, 0, 1)), _mm_setr_ps(-0.0f, 0.0f, -0.0f, 0.0f));
+		__m128 by = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(1, 0, 3, 2)), _mm_setr_ps(-0.0f, 0.0f, 0.0f, -0.0f));
+		__m128 bz = _mm_xor_ps(_mm_shuffle_ps(vb, vb, _MM_SHUFFLE(0, 1, 2, 3)), _mm_setr_ps(-0.0f, -0.0f, 0.0f, 0.0f));
+		__m128 result = _mm_mul_ps(_mm_shuffle_ps(va, va, _MM_SHUFFLE(0, 0, 0, 0)), vb);
+		result = fma(_mm_shuffle_ps(va, va, _MM_SHUFFLE(1, 1, 1, 1)), bx, result);
+		result = fma(_mm_shuffle_ps(va, va, _MM_SHUFFLE(2, 2, 2, 2)), by, result);
+		result = fma(_mm_shuffle_ps(va, va, _MM_SHUFFLE(3, 3, 3, 3)), bz, result);
+		_mm_storeu_ps(a.data, result);
+		return a;
+	}
+
 
 
 	// Other math functions
@@ -208,8 +227,8 @@ namespace util
 	inline float4x4 affineMatrix(quat q, float3 translationPart)
 		{ return affineMatrix(rotationMatrixFromQuat(q), translationPart); }
 
-	inline float dot(quat a, quat b)
-		{ return a.w*b.w + a.x*b.x + a.y*b.y + a.z*b.z; }
+	constexpr float dot(quat a, quat b)
+		{ return a[0]*b[0] + a[1]*b[1] + a[2]*b[2] + a[3]*b[3]; }
 
 	inline float lengthSquared(quat a)
 		{ return dot(a, a); }
@@ -220,8 +239,8 @@ namespace util
 	inline quat normalize(quat a)
 		{ return a / length(a); }
 
-	inline quat conjugate(quat a)
-		{ return { a.w, -a.x, -a.y, -a.z }; }
+	constexpr quat conjugate(quat a)
+		{ return { a[0], -a[1], -a[2], -a[3] }; }
 
 	inline quat pow(quat a, int b)
 	{
@@ -245,12 +264,15 @@ namespace util
 	inline quat inverse(quat a)
 		{ return conjugate(a) / lengthSquared(a); }
 
-	// Apply a normalized quat as a rotation to a vector
-	inline float3 applyQuat(quat a, float3 b)
+	// Apply a normalized quat as a rotation to a vector.  This is a * b * conjugate(a) expanded
+	// out and simplified: with u = a.xyz and t = 2 * cross(u, b), the result is
+	// b + a.w * t + cross(u, t), which is 15 multiplies rather than the 32 of two quat products.
+	// For many vectors at once, see applyQuatBatch() in util-containers.h.
+	constexpr float3 applyQuat(quat a, float3 b)
 	{
-		quat v = { 0, b.x, b.y, b.z };
-		quat resultQ = a * v * conjugate(a);
-		return float3(resultQ.x, resultQ.y, resultQ.z);
+		float3 u(a[1], a[2], a[3]);
+		float3 t = 2.0f * cross(u, b);
+		return b + a[0] * t + cross(u, t);
 	}
 
 	inline quat slerp(quat a, quat b, float u)
@@ -353,4 +375,7 @@ namespace util
 	quat quatFromAxisAngle(float3 axis, float radians);
 	quat quatFromEuler(float3 euler);
 	quat quatFromRotationMatrix(float3x3 const & a);
+
+	// Polar decomposition a = rotationMatrixFromQuat(*pRotationOut) * *pStretchOut; see util-matrix.h
+	void polarDecompose(float3x3 const & a, quat * pRotationOut, float3x3 * pStretchOut);
 }
@@ -0,0 +1,327 @@
+#pragma once
+#include "util-simd.h"
+
+namespace util
+{
+	// Math functions for the SIMD lane types __m128, __m256, and __m512, so that things
+	// like length(), normalize(), and pow() work on SIMD vectors as well as scalar ones.
+
+	// The transcendental functions are branchless polynomial approximations, mostly
+	// following Cephes (http://www.netlib.org/cephes/).  Max errors below are in ulp,
+	// measured against double precision by sampling every 29th float in the domain (all
+	// floats, or all positive floats for log/log2/sqrt/rcp/rsqrt), or 2M random points for
+	// pow and atan2.  Results are the same for every lane width, except that rcp/rsqrt on
+	// __m512 start from a more precise hardware estimate.
+	//
+	//   sqrt			0.5 ulp (exact, from the hardware)
+	//   rcp			2.8 ulp (0.6 ulp for __m512); hardware estimate + one Newton-Raphson step
+	//   rsqrt			4.2 ulp (2.0 ulp for __m512); likewise
+	//   exp2			1.2 ulp
+	//   exp			1.0 ulp
+	//   log2			1.4 ulp
+	//   log			0.9 ulp
+	//   pow			14 ulp for |y| <= 4 and results in [2^-20, 2^20]; grows with |y*log2(x)|
+	//   sin, cos		1.5 ulp on [-pi, pi]; for |x| <= 8192, absolute error <= 8e-8
+	//   acos			1.3 ulp
+	//   atan2			3.3 ulp
+	//
+	// Special cases: exp/exp2 overflow to inf and underflow through denormals to 0; log/log2
+	// of 0 is -inf and of negatives is NaN; pow of a negative base is NaN, even for integer
+	// exponents, and pow(x, 0) = 1; atan2(0, 0) is 0; atan2(inf, inf) is NaN.  NaNs propagate.
+
+	inline __m128 sqrt(__m128 a)
+		{ return _mm_sqrt_ps(a); }
+	inline __m256 sqrt(__m256 a)
+		{ return _mm256_sqrt_ps(a); }
+	inline __m512 sqrt(__m512 a)
+		{ return _mm512_sqrt_ps(a); }
+
+	// Implementations of the rest, generic over the lane type
+	namespace impl
+	{
+		// Polynomial evaluation by Horner's rule, with coefficients in order of decreasing degree
+		template <typename L, int n>
+		inline L polynomial(L x, const float (&coeffs)[n])
+		{
+			L result = x * coeffs[0] + coeffs[1];
+			for (int i = 2; i < n; ++i)
+				result = result * x + coeffs[i];
+			return result;
+		}
+
+		// Multiply by 2^n for integer lanes n.  The scale is split into two factors so that
+		// each one is a normal float for any n in [-252, 254], which lets the result range
+		// smoothly into denormals or overflow to inf.
+		template <typename L, typename Li>
+		inline L scaleByPow2(L x, Li n)
+		{
+			Li half = n >> 1;
+			return x * bitsAsFloat((half + 127) << 23) * bitsAsFloat((n - half + 127) << 23);
+		}
+
+		template <typename L>
+		L exp2(L x)
+		{
+			// Clamp to a range where the exponent arithmetic can't overflow; outside it the
+			// result is inf or 0 anyway.  Argument order lets NaNs pass through (see min/max).
+			x = min(splat<L>(129.0f), max(splat<L>(-151.0f), x));
+
+			// Split into integer and fractional parts, with the fraction in [-0.5, 0.5]
+			auto n = roundToInt(x);
+			L f = x - toFloat(n);
+
+			static const float coeffs[] =
+			{
+				1.535336188319500e-4f,
+				1.339887440266574e-3f,
+				9.618437357674640e-3f,
+				5.550332471162809e-2f,
+				2.402264791363012e-1f,
+				6.931472028550421e-1f,
+			};
+			return scaleByPow2(f * polynomial(f, coeffs) + 1.0f, n);
+		}
+
+		template <typename L>
+		L exp(L x)
+		{
+			x = min(splat<L>(89.5f), max(splat<L>(-104.5f), x));
+
+			// Cody-Waite range reduction: ln(2) is split into a part exactly representable
+			// in a few bits, plus a small correction, so the reduction doesn't lose precision
+			auto n = roundToInt(x * 1.44269504088896341f);
+			L fn = toFloat(n);
+			L r = (x - fn * 0.693359375f) + fn * 2.12194440e-4f;
+
+			static const float coeffs[] =
+			{
+				1.9875691500e-4f,
+				1.3981999507e-3f,
+				8.3334519073e-3f,
+				4.1665795894e-2f,
+				1.6666665459e-1f,
+				5.0000001201e-1f,
+			};
+			return scaleByPow2(r * r * polynomial(r, coeffs) + r + 1.0f, n);
+		}
+
+		// Split positive x into m + 1 and 2^e, with m + 1 in [sqrt(1/2), sqrt(2)), and
+		// evaluate the polynomial part of log(m + 1)
+		template <typename L>
+		L logReduce(L x, L * pMOut, L * pEOut)
+		{
+			// Scale up denormals so they have an exponent to extract
+			auto isDenormal = x < FLT_MIN;
+			x = select(isDenormal, x * 8388608.0f, x);
+
+			auto bits = bitsAsInt(x);
+			L e = toFloat(((bits >> 23) & 0xff) - 126);
+			e = select(isDenormal, e - 23.0f, e);
+			L m = bitsAsFloat((bits & ~0x7f800000) | 0x3f000000);	// in [0.5, 1)
+
+			auto isSmall = m < 0.707106781186547524f;
+			e = select(isSmall, e - 1.0f, e);
+			m = select(isSmall, m + m, m) - 1.0f;
+
+			static const float coeffs[] =
+			{
+				7.0376836292e-2f,
+				-1.1514610310e-1f,
+				1.1676998740e-1f,
+				-1.2420140846e-1f,
+				1.4249322787e-1f,
+				-1.6668057665e-1f,
+				2.0000714765e-1f,
+				-2.4999993993e-1f,
+				3.3333331174e-1f,
+			};
+			L z = m * m;
+			*pMOut = m;
+			*pEOut = e;
+			return m * z * polynomial(m, coeffs) - 0.5f * z;
+		}
+
+		template <typename L>
+		L logSpecialCases(L x, L result)
+		{
+			result = select(x == infinity, x, result);
+			result = select(x == 0.0f, -infinity, result);
+			result = select(x < 0.0f, NaN, result);
+			return select(x != x, x, result);
+		}
+
+		template <typename L>
+		L log(L x)
+		{
+			L m, e;
+			L y = logReduce(x, &m, &e);
+			L result = (m + (y + e * -2.12194440e-4f)) + e * 0.693359375f;
+			return logSpecialCases(x, result);
+		}
+
+		template <typename L>
+		L log2(L x)
+		{
+			L m, e;
+			L y = logReduce(x, &m, &e);
+
+			// Multiply by log2(e) = 1 + 0.442695..., with the 1 part done exactly
+			static const float log2eMinus1 = 0.44269504088896340736f;
+			L result = (y * log2eMinus1 + m * log2eMinus1) + y + m + e;
+			return logSpecialCases(x, result);
+		}
+
+		template <typename L>
+		L pow(L x, L y)
+		{
+			L result = exp2(y * log2(x));
+			result = select(x == 1.0f, 1.0f, result);
+			return select(y == 0.0f, 1.0f, result);
+		}
+
+		template <typename L>
+		void sincos(L x, L * pSinOut, L * pCosOut)
+		{
+			// Reduce to an octant: j = nearest even integer to |x| * 4/pi.  pi/4 is split
+			// into three parts, as in exp, so the reduction stays accurate for large |x|.
+			L ax = abs(x);
+			auto j = (truncToInt(ax * 1.27323954473516f) + 1) & ~1;
+			L fj = toFloat(j);
+			L r = ((ax - fj * 0.78515625f) - fj * 2.4187564849853515625e-4f) - fj * 3.77489497744594108e-8f;
+			L z = r * r;
+
+			static const float sinCoeffs[] =
+			{
+				-1.9515295891e-4f,
+				8.3321608736e-3f,
+				-1.6666654611e-1f,
+			};
+			static const float cosCoeffs[] =
+			{
+				2.443315711809948e-5f,
+				-1.388731625493765e-3f,
+				4.166664568298827e-2f,
+			};
+			L polySin = r * z * polynomial(z, sinCoeffs) + r;
+			L polyCos = (z * z * polynomial(z, cosCoeffs) - 0.5f * z) + 1.0f;
+
+			// In octants 2 and 6, sin and cos trade places.  Sin is negative in octants 4 and 6
+			// (and for negative x); cos is negative in octants 2 and 4.
+			auto swap = (j & 2) == 2;
+			auto sinSign = ((j & 4) << 29) ^ (bitsAsInt(x) & ~0x7fffffff);
+			auto cosSign = ((j + 2) & 4) << 29;
+			*pSinOut = bitsAsFloat(bitsAsInt(select(swap, polyCos, polySin)) ^ sinSign);
+			*pCosOut = bitsAsFloat(bitsAsInt(select(swap, polySin, polyCos)) ^ cosSign);
+		}
+
+		// Arcsine of a in [0, 0.5], for acos below
+		template <typename L>
+		L asinSmall(L a, L z)
+		{
+			static const float coeffs[] =
+			{
+				4.2163199048e-2f,
+				2.4181311049e-2f,
+				4.5470025998e-2f,
+				7.4953002686e-2f,
+				1.6666752422e-1f,
+			};
+			return a * z * polynomial(z, coeffs) + a;
+		}
+
+		template <typename L>
+		L acos(L x)
+		{
+			// For |x| > 0.5, use acos(|x|) = 2 asin(sqrt((1 - |x|) / 2)), otherwise
+			// acos(|x|) = pi/2 - asin(|x|).  Then reflect for negative x.
+			L ax = abs(x);
+			auto isLarge = ax > 0.5f;
+			L z = select(isLarge, 0.5f - 0.5f * ax, ax * ax);
+			L a = select(isLarge, sqrt(z), ax);
+			L p = asinSmall(a, z);
+			L result = select(isLarge, p + p, 0.5f * pi - p);
+			return select(x < 0.0f, pi - result, result);
+		}
+
+		template <typename L>
+		L atan2(L y, L x)
+		{
+			// Compute atan of the smaller over the larger magnitude, in [0, 1], then use
+			// symmetries to get the other octants
+			L ax = abs(x);
+			L ay = abs(y);
+			L maxXY = max(ax, ay);
+			L t = min(ax, ay) / maxXY;
+
+			// Reduce [tan(pi/8), 1] to [tan(-pi/8), 0] using atan(t) = pi/4 + atan((t-1)/(t+1))
+			auto isLarge = t > 0.414213562373095f;
+			t = select(isLarge, (t - 1.0f) / (t + 1.0f), t);
+
+			static const float coeffs[] =
+			{
+				8.05374449538e-2f,
+				-1.38776856032e-1f,
+				1.99777106478e-1f,
+				-3.33329491539e-1f,
+			};
+			L z = t * t;
+			L result = t * z * polynomial(z, coeffs) + t;
+			result = select(isLarge, result + 0.25f * pi, result);
+
+			result = select(maxXY == 0.0f, 0.0f, result);
+			result = select(ay > ax, 0.5f * pi - result, result);
+			result = select(x < 0.0f, pi - result, result);
+
+			// Copy the sign of y
+			return bitsAsFloat(bitsAsInt(result) ^ (bitsAsInt(y) & ~0x7fffffff));
+		}
+
+		// One Newton-Raphson step to refine hardware estimates of 1/a and 1/sqrt(a).
+		// For zero or infinite a the step produces NaN, so keep the estimate there.
+		template <typename L>
+		L refineRcp(L a, L r)
+		{
+			L refined = r * (1.0f - a * r) + r;
+			return select(refined == refined, refined, r);
+		}
+		template <typename L>
+		L refineRsqrt(L a, L r)
+		{
+			L refined = r * (0.5f - 0.5f * a * r * r) + r;
+			return select(refined == refined, refined, r);
+		}
+	}
+
+	inline __m128 rcp(__m128 a)
+		{ __m128 r = _mm_rcp_ps(a); return impl::refineRcp(a, r); }
+	inline __m256 rcp(__m256 a)
+		{ __m256 r = _mm256_rcp_ps(a); return impl::refineRcp(a, r); }
+	inline __m512 rcp(__m512 a)
+		{ __m512 r = _mm512_rcp14_ps(a); return impl::refineRcp(a, r); }
+
+	inline __m128 rsqrt(__m128 a)
+		{ __m128 r = _mm_rsqrt_ps(a); return impl::refineRsqrt(a, r); }
+	inline __m256 rsqrt(__m256 a)
+		{ __m256 r = _mm256_rsqrt_ps(a); return impl::refineRsqrt(a, r); }
+	inline __m512 rsqrt(__m512 a)
+		{ __m512 r = _mm512_rsqrt14_ps(a); return impl::refineRsqrt(a, r); }
+
+#define DEFINE_SIMD_MATH_FUNCTIONS(L) \
+			inline L exp(L x) { return impl::exp(x); } \
+			inline L exp2(L x) { return impl::exp2(x); } \
+			inline L log(L x) { return impl::log(x); } \
+			inline L log2(L x) { return impl::log2(x); } \
+			inline L pow(L x, L y) { return impl::pow(x, y); } \
+			inline L pow(L x, float y) { return impl::pow(x, splat<L>(y)); } \
+			inline L sin(L x) { L s, c; impl::sincos(x, &s, &c); return s; } \
+			inline L cos(L x) { L s, c; impl::sincos(x, &s, &c); return c; } \
+			inline void sincos(L x, L * pSinOut, L * pCosOut) { impl::sincos(x, pSinOut, pCosOut); } \
+			inline L acos(L x) { return impl::acos(x); } \
+			inline L atan2(L y, L x) { return impl::atan2(y, x); }
+
+	DEFINE_SIMD_MATH_FUNCTIONS(__m128);
+	DEFINE_SIMD_MATH_FUNCTIONS(__m256);
+	DEFINE_SIMD_MATH_FUNCTIONS(__m512);
+
+#undef DEFINE_SIMD_MATH_FUNCTIONS
+}
@@ -1,25 +1,152 @@
 #include "util-math.h"
+#include "util-containers.h"
+#include <intrin.h>
 
 namespace util
 {
+	// Division by a runtime-invariant integer
+
+	divisor::divisor(int value_)
+	:	value(value_),
+		multiplier(0),
+		shift(0),
+		addMask(~0),
+		negMask((value_ < 0) ? ~0 : 0),
+		roundMask(0)
+	{
+		ASSERT_ERR(value_ != 0);
+
+		// Dividing by +-1 is just (possibly negated) addition of the dividend to 0
+		if (value_ == 1 || value_ == -1)
+			return;
+
+		// Find the magic number, following Hacker's Delight, figure 10-1
+		const uint two31 = 0x80000000u;
+		uint ad = (value_ < 0) ? (0u - uint(value_)) : uint(value_);
+		uint t = two31 + (uint(value_) >> 31);
+		uint anc = t - 1 - t % ad;
+		int p = 31;
+		uint q1 = two31 / anc, r1 = two31 - q1 * anc;
+		uint q2 = two31 / ad, r2 = two31 - q2 * ad;
+		uint delta;
+		do
+		{
+			++p;
+			q1 *= 2; r1 *= 2;
+			if (r1 >= anc) { ++q1; r1 -= anc; }
+			q2 *= 2; r2 *= 2;
+			if (r2 >= ad) { ++q2; r2 -= ad; }
+			delta = ad - r2;
+		} while (q1 < delta || (q1 == delta && r1 == 0));
+
+		multiplier = int(q2 + 1);
+		if (value_ < 0)
+			multiplier = -multiplier;
+		shift = p - 32;
+
+		// The dividend is added to the product if the magic number overflowed into the sign bit,
+		// or subtracted if a negative divisor's magic number didn't
+		if (value_ > 0)
+			addMask = (multiplier < 0) ? ~0 : 0;
+		else
+			addMask = (multiplier > 0) ? ~0 : 0;
+		roundMask = ~0;
+	}
+
+
+
+	// Runtime CPU feature detection and dispatch
+
+	static ISA detectISAUncached()
+	{
+		int info[4];
+		__cpuid(info, 0);
+		int maxLeaf = info[0];
+
+		// AVX2 requires the OS to save the YMM registers on context switch (OSXSAVE, and XCR0
+		// bits 1-2), as well as the CPU supporting it.  We also require FMA3 along with AVX2,
+		// as every CPU that has one has the other.
+		__cpuid(info, 1);
+		bool fma = (info[2] & (1 << 12)) != 0;
+		bool osxsave = (info[2] & (1 << 27)) != 0;
+		bool avx = (info[2] & (1 << 28)) != 0;
+		if (!fma || !osxsave || !avx || maxLeaf < 7)
+			return ISA_SSE2;
+
+		unsigned __int64 xcr0 = _xgetbv(0);
+		if ((xcr0 & 0x6) != 0x6)
+			return ISA_SSE2;
+
+		__cpuidex(info, 7, 0);
+		bool avx2 = (info[1] & (1 << 5)) != 0;
+		bool avx512f = (info[1] & (1 << 16)) != 0;
+		if (!avx2)
+			return ISA_SSE2;
+
+		// AVX-512 additionally needs the opmask and ZMM state enabled (XCR0 bits 5-7)
+		if (!avx512f || (xcr0 & 0xe0) != 0xe0)
+			return ISA_AVX2;
+
+		return ISA_AVX512;
+	}
+
+	ISA detectISA()
+	{
+		// Function-local static, so it's initialized (thread-safely) on first use
+		static const ISA s_isaDetected = detectISAUncached();
+		return s_isaDetected;
+	}
+
+	static ISA s_isaForced = ISA_Count;
+
+	ISA currentISA()
+	{
+		return (s_isaForced < ISA_Count) ? s_isaForced : detectISA();
+	}
+
+	void forceISA(ISA isa)
+	{
+		ASSERT_ERR(isa >= 0 && isa <= ISA_Count);
+
+		if (isa < ISA_Count && isa > detectISA())
+		{
+			WARN("Can't force ISA %s, as this machine only supports %s", nameOfISA(isa), nameOfISA(detectISA()));
+			isa = detectISA();
+		}
+
+		s_isaForced = isa;
+	}
+
+	const char * nameOfISA(ISA isa)
+	{
+		static const char * s_names[] =
+		{
+			"SSE2",
+			"AVX2",
+			"AVX-512",
+		};
+		cassert(dim(s_names) == ISA_Count);
+
+		ASSERT_ERR(isa >= 0 && isa < ISA_Count);
+		return s_names[isa];
+	}
+
+
+
 	// Convert memory layouts to and from SIMD-friendly (AOSOA) layout
 
-	void convertToAOSOA(
+	// Generic versions, for any numComponents and vectorsPerChunk
+
+	static void convertToAOSOAGeneric(
 		int numComponents,
 		int numVectors,
 		const void * pInput,
 		int inputStrideBytes,
 		void * pOutput,
 		int outputStrideBytes,
-		int vectorsPerChunk /*= 4*/)
+		int vectorsPerChunk,
+		bool /*streaming*/)
 	{
-		ASSERT_ERR(numComponents > 0);
-		ASSERT_ERR(pInput);
-		ASSERT_ERR(inputStrideBytes >= sizeof(float) * numComponents);
-		ASSERT_ERR(pOutput);
-		ASSERT_ERR((size_t)pOutput % (vectorsPerChunk * sizeof(float)) == 0);
-		ASSERT_ERR(outputStrideBytes >= vectorsPerChunk * sizeof(float) * numComponents);
-
 		// Do the part that's a multiple of vectorsPerChunk
 		for (; numVectors >= vectorsPerChunk; numVectors -= vectorsPerChunk)
 		{
@@ -44,22 +171,15 @@ namespace util
 		}
 	}
 
-	void convertFromAOSOA(
+	static void convertFromAOSOAGeneric(
 		int numComponents,
 		int numVectors,
 		const void * pInput,
 		int inputStrideBytes,
 		void * pOutput,
 		int outputStrideBytes,
-		int vectorsPerChunk /*= 4*/)
+		int vectorsPerChunk)
 	{
-		ASSERT_ERR(numComponents > 0);
-		ASSERT_ERR(pInput);
-		ASSERT_ERR((size_t)pInput % (vectorsPerChunk * sizeof(float)) == 0);
-		ASSERT_ERR(inputStrideBytes >= vectorsPerChunk * sizeof(float) * numComponents);
-		ASSERT_ERR(pOutput);
-		ASSERT_ERR(outputStrideBytes >= sizeof(float) * numComponents);
-
 		// Do the part that's a multiple of vectorsPerChunk
 		for (; numVectors >= vectorsPerChunk; numVectors -= vectorsPerChunk)
 		{
@@ -83,4 +203,1783 @@ namespace util
 			pOutput = offsetPtr(pOutput, outputStrideBytes);
 		}
 	}
+
+
+
+	// Specialized versions, for numComponents of 2, 3, or 4 and vectorsPerChunk of 4, 8, or 16.
+	// These transpose blocks of 4 (SSE) or 8 (AVX) vectors at a time in registers.  The leftover
+	// partial chunk, if any, is done the same way, with the last block loading only the vectors
+	// that exist and storing only their lanes (so the rest of the chunk isn't touched).
+
+
+	// Load a single AOS vector into an SSE register, in xyzw order; unused components are
+	// garbage.  For 3-component vectors this normally reads a whole 4 floats, i.e. past the end
+	// of the vector, which is fine except for the very last vector in the array, so there's an
+	// exact version for that.
+	template <int nc> __m128 loadAOSVector(const float * p, bool exact);
+	template <> inline __m128 loadAOSVector<2>(const float * p, bool /*exact*/)
+	{
+		return _mm_castpd_ps(_mm_load_sd((const double *)p));
+	}
+	template <> inline __m128 loadAOSVector<3>(const float * p, bool exact)
+	{
+		if (exact)
+			return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double *)p)), _mm_load_ss(p + 2));
+		return _mm_loadu_ps(p);
+	}
+	template <> inline __m128 loadAOSVector<4>(const float * p, bool /*exact*/)
+	{
+		return _mm_loadu_ps(p);
+	}
+
+	// Store a single vector from an SSE register to AOS layout.  Only the vector's own components
+	// are written, so as not to clobber any other data interleaved with the vectors.
+	template <int nc> void storeAOSVector(float * p, __m128 v);
+	template <> inline void storeAOSVector<2>(float * p, __m128 v)
+	{
+		_mm_store_sd((double *)p, _mm_castps_pd(v));
+	}
+	template <> inline void storeAOSVector<3>(float * p, __m128 v)
+	{
+		_mm_store_sd((double *)p, _mm_castps_pd(v));
+		_mm_store_ss(p + 2, _mm_movehl_ps(v, v));
+	}
+	template <> inline void storeAOSVector<4>(float * p, __m128 v)
+	{
+		_mm_storeu_ps(p, v);
+	}
+
+	// When streaming, prefetch the input some distance ahead.  The hardware prefetcher takes
+	// care of tightly packed input (and extra prefetch instructions only slow it down), but it
+	// can fall behind when each vector is on its own cache line.  Prefetches don't fault, so
+	// it's fine for this to run past the end of the array.
+	static const int s_prefetchAheadVectors = 8;
+	static const int s_prefetchMinStrideBytes = 64;
+	inline void prefetchAOSVector(const void * p, int strideBytes)
+	{
+		_mm_prefetch((const char *)offsetPtr(p, s_prefetchAheadVectors * strideBytes), _MM_HINT_T0);
+	}
+
+	// 4x4 transpose within each 128-bit half of four AVX registers, analogous to
+	// _MM_TRANSPOSE4_PS
+	inline void transpose4x4Halves(__m256 & r0, __m256 & r1, __m256 & r2, __m256 & r3)
+	{
+		__m256 t0 = _mm256_unpacklo_ps(r0, r1);
+		__m256 t1 = _mm256_unpackhi_ps(r0, r1);
+		__m256 t2 = _mm256_unpacklo_ps(r2, r3);
+		__m256 t3 = _mm256_unpackhi_ps(r2, r3);
+		r0 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(1, 0, 1, 0));
+		r1 = _mm256_shuffle_ps(t0, t2, _MM_SHUFFLE(3, 2, 3, 2));
+		r2 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(1, 0, 1, 0));
+		r3 = _mm256_shuffle_ps(t1, t3, _MM_SHUFFLE(3, 2, 3, 2));
+	}
+
+	template <int nc, int vpc>
+	struct ConvertToAOSOASSE
+	{
+		static void run(
+			int numVectors,
+			const void * pInput,
+			int inputStrideBytes,
+			void * pOutput,
+			int outputStrideBytes,
+			bool streaming)
+		{
+			bool prefetch = streaming && (inputStrideBytes >= s_prefetchMinStrideBytes);
+
+			// Non-temporal stores must be aligned
+			streaming = streaming && (outputStrideBytes % sizeof(__m128) == 0);
+
+			int numChunks = numVectors / vpc;
+			for (int iChunk = 0; iChunk < numChunks; ++iChunk)
+			{
+				// Only the last vector of the whole array needs an exact load
+				bool lastChunk = (iChunk == numChunks - 1 && numVectors == numChunks * vpc);
+
+				float * pOut = (float *)pOutput;
+				for (int i = 0; i < vpc; i += 4)
+				{
+					__m128 r[4];
+					for (int k = 0; k < 4; ++k)
+					{
+						if (prefetch)
+							prefetchAOSVector(pInput, inputStrideBytes);
+						r[k] = loadAOSVector<nc>((const float *)pInput, lastChunk && i == vpc - 4 && k == 3);
+						pInput = offsetPtr(pInput, inputStrideBytes);
+					}
+
+					_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+					if (streaming)
+					{
+						for (int j = 0; j < nc; ++j)
+							_mm_stream_ps(pOut + vpc*j + i, r[j]);
+					}
+					else
+					{
+						for (int j = 0; j < nc; ++j)
+							_mm_storeu_ps(pOut + vpc*j + i, r[j]);
+					}
+				}
+
+				pOutput = offsetPtr(pOutput, outputStrideBytes);
+			}
+
+			// Do any part left over
+			int numLeft = numVectors - numChunks * vpc;
+			float * pOut = (float *)pOutput;
+			for (int i = 0; i < numLeft; i += 4)
+			{
+				// Loop over the whole block (rather than just count) so r[] can stay in registers
+				int count = min(numLeft - i, 4);
+				__m128 r[4];
+				for (int k = 0; k < 4; ++k)
+				{
+					if (k < count)
+					{
+						r[k] = loadAOSVector<nc>((const float *)pInput, k == count - 1);
+						pInput = offsetPtr(pInput, inputStrideBytes);
+					}
+					else
+						r[k] = _mm_setzero_ps();
+				}
+
+				_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+				for (int j = 0; j < nc; ++j)
+					storePartial(pOut + vpc*j + i, r[j], count);
+			}
+		}
+	};
+
+	template <int nc, int vpc>
+	struct ConvertFromAOSOASSE
+	{
+		static void run(
+			int numVectors,
+			const void * pInput,
+			int inputStrideBytes,
+			void * pOutput,
+			int outputStrideBytes)
+		{
+			int numChunks = numVectors / vpc;
+			for (int iChunk = 0; iChunk < numChunks; ++iChunk)
+			{
+				const float * pIn = (const float *)pInput;
+				for (int i = 0; i < vpc; i += 4)
+				{
+					// Don't read past the end of the chunk for components we don't have
+					__m128 r[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), };
+					for (int j = 0; j < nc; ++j)
+						r[j] = _mm_loadu_ps(pIn + vpc*j + i);
+
+					_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+					for (int k = 0; k < 4; ++k)
+					{
+						storeAOSVector<nc>((float *)pOutput, r[k]);
+						pOutput = offsetPtr(pOutput, outputStrideBytes);
+					}
+				}
+
+				pInput = offsetPtr(pInput, inputStrideBytes);
+			}
+
+			// Do any part left over
+			int numLeft = numVectors - numChunks * vpc;
+			const float * pIn = (const float *)pInput;
+			for (int i = 0; i < numLeft; i += 4)
+			{
+				int count = min(numLeft - i, 4);
+				__m128 r[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), };
+				for (int j = 0; j < nc; ++j)
+					r[j] = loadPartial<__m128>(pIn + vpc*j + i, count);
+
+				_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+				for (int k = 0; k < 4; ++k)
+				{
+					if (k < count)
+					{
+						storeAOSVector<nc>((float *)pOutput, r[k]);
+						pOutput = offsetPtr(pOutput, outputStrideBytes);
+					}
+				}
+			}
+		}
+	};
+
+	template <int nc, int vpc>
+	struct ConvertToAOSOAAVX
+	{
+		static void run(
+			int numVectors,
+			const void * pInput,
+			int inputStrideBytes,
+			void * pOutput,
+			int outputStrideBytes,
+			bool streaming)
+		{
+			bool prefetch = streaming && (inputStrideBytes >= s_prefetchMinStrideBytes);
+
+			// Non-temporal stores must be aligned
+			streaming = streaming && (outputStrideBytes % sizeof(__m256) == 0);
+
+			int numChunks = numVectors / vpc;
+			for (int iChunk = 0; iChunk < numChunks; ++iChunk)
+			{
+				// Only the last vector of the whole array needs an exact load
+				bool lastChunk = (iChunk == numChunks - 1 && numVectors == numChunks * vpc);
+
+				float * pOut = (float *)pOutput;
+				for (int i = 0; i < vpc; i += 8)
+				{
+					// Vectors 0-3 go in the low halves of the registers and 4-7 in the high halves
+					const void * pInputHigh = offsetPtr(pInput, 4 * inputStrideBytes);
+					__m256 r[4];
+					for (int k = 0; k < 4; ++k)
+					{
+						if (prefetch)
+						{
+							prefetchAOSVector(pInput, inputStrideBytes);
+							prefetchAOSVector(pInputHigh, inputStrideBytes);
+						}
+						__m128 low = loadAOSVector<nc>((const float *)pInput, false);
+						__m128 high = loadAOSVector<nc>((const float *)pInputHigh, lastChunk && i == vpc - 8 && k == 3);
+						r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+						pInput = offsetPtr(pInput, inputStrideBytes);
+						pInputHigh = offsetPtr(pInputHigh, inputStrideBytes);
+					}
+					pInput = pInputHigh;
+
+					transpose4x4Halves(r[0], r[1], r[2], r[3]);
+
+					if (streaming)
+					{
+						for (int j = 0; j < nc; ++j)
+							_mm256_stream_ps(pOut + vpc*j + i, r[j]);
+					}
+					else
+					{
+						for (int j = 0; j < nc; ++j)
+							_mm256_storeu_ps(pOut + vpc*j + i, r[j]);
+					}
+				}
+
+				pOutput = offsetPtr(pOutput, outputStrideBytes);
+			}
+
+			// Do any part left over
+			int numLeft = numVectors - numChunks * vpc;
+			float * pOut = (float *)pOutput;
+			for (int i = 0; i < numLeft; i += 8)
+			{
+				// Loop over the whole block (rather than just count) so v[] can stay in registers
+				int count = min(numLeft - i, 8);
+				__m128 v[8];
+				for (int k = 0; k < 8; ++k)
+				{
+					if (k < count)
+					{
+						v[k] = loadAOSVector<nc>((const float *)pInput, k == count - 1);
+						pInput = offsetPtr(pInput, inputStrideBytes);
+					}
+					else
+						v[k] = _mm_setzero_ps();
+				}
+
+				__m256 r[4];
+				for (int k = 0; k < 4; ++k)
+					r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(v[k]), v[k + 4], 1);
+
+				transpose4x4Halves(r[0], r[1], r[2], r[3]);
+
+				for (int j = 0; j < nc; ++j)
+					storePartial(pOut + vpc*j + i, r[j], count);
+			}
+
+			_mm256_zeroupper();
+		}
+	};
+
+	template <int nc, int vpc>
+	struct ConvertFromAOSOAAVX
+	{
+		static void run(
+			int numVectors,
+			const void * pInput,
+			int inputStrideBytes,
+			void * pOutput,
+			int outputStrideBytes)
+		{
+			int numChunks = numVectors / vpc;
+			for (int iChunk = 0; iChunk < numChunks; ++iChunk)
+			{
+				const float * pIn = (const float *)pInput;
+				for (int i = 0; i < vpc; i += 8)
+				{
+					// Don't read past the end of the chunk for components we don't have
+					__m256 r[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), };
+					for (int j = 0; j < nc; ++j)
+						r[j] = _mm256_loadu_ps(pIn + vpc*j + i);
+
+					transpose4x4Halves(r[0], r[1], r[2], r[3]);
+
+					// Vectors 0-3 are now in the low halves of the registers and 4-7 in the high halves
+					void * pOutputHigh = offsetPtr(pOutput, 4 * outputStrideBytes);
+					for (int k = 0; k < 4; ++k)
+					{
+						storeAOSVector<nc>((float *)pOutput, _mm256_castps256_ps128(r[k]));
+						storeAOSVector<nc>((float *)pOutputHigh, _mm256_extractf128_ps(r[k], 1));
+						pOutput = offsetPtr(pOutput, outputStrideBytes);
+						pOutputHigh = offsetPtr(pOutputHigh, outputStrideBytes);
+					}
+					pOutput = pOutputHigh;
+				}
+
+				pInput = offsetPtr(pInput, inputStrideBytes);
+			}
+
+			// Do any part left over
+			int numLeft = numVectors - numChunks * vpc;
+			const float * pIn = (const float *)pInput;
+			for (int i = 0; i < numLeft; i += 8)
+			{
+				int count = min(numLeft - i, 8);
+				__m256 r[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), };
+				for (int j = 0; j < nc; ++j)
+					r[j] = loadPartial<__m256>(pIn + vpc*j + i, count);
+
+				transpose4x4Halves(r[0], r[1], r[2], r[3]);
+
+				void * pOutputHigh = offsetPtr(pOutput, 4 * outputStrideBytes);
+				for (int k = 0; k < 4; ++k)
+				{
+					if (k < count)
+						storeAOSVector<nc>((float *)pOutput, _mm256_castps256_ps128(r[k]));
+					if (k + 4 < count)
+						storeAOSVector<nc>((float *)pOutputHigh, _mm256_extractf128_ps(r[k], 1));
+					pOutput = offsetPtr(pOutput, outputStrideBytes);
+					pOutputHigh = offsetPtr(pOutputHigh, outputStrideBytes);
+				}
+				pOutput = pOutputHigh;
+			}
+
+			_mm256_zeroupper();
+		}
+	};
+
+	// The AVX versions work in blocks of 8 vectors, so for 4 vectors per chunk, use SSE
+	template <int nc>
+	struct ConvertToAOSOAAVX<nc, 4> : public ConvertToAOSOASSE<nc, 4> {};
+	template <int nc>
+	struct ConvertFromAOSOAAVX<nc, 4> : public ConvertFromAOSOASSE<nc, 4> {};
+
+	// Find the specialized kernel instance for a given numComponents and vectorsPerChunk,
+	// or nullptr if there isn't one
+	template <template <int, int> class Kernel, int nc>
+	static decltype(&Kernel<nc, 4>::run) pickKernel(int vectorsPerChunk)
+	{
+		switch (vectorsPerChunk)
+		{
+		case 4:		return &Kernel<nc, 4>::run;
+		case 8:		return &Kernel<nc, 8>::run;
+		case 16:	return &Kernel<nc, 16>::run;
+		default:	return nullptr;
+		}
+	}
+	template <template <int, int> class Kernel>
+	static decltype(&Kernel<4, 4>::run) pickKernel(int numComponents, int vectorsPerChunk)
+	{
+		switch (numComponents)
+		{
+		case 2:		return pickKernel<Kernel, 2>(vectorsPerChunk);
+		case 3:		return pickKernel<Kernel, 3>(vectorsPerChunk);
+		case 4:		return pickKernel<Kernel, 4>(vectorsPerChunk);
+		default:	return nullptr;
+		}
+	}
+
+	static void convertToAOSOASSE(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk,
+		bool streaming)
+	{
+		if (auto pfn = pickKernel<ConvertToAOSOASSE>(numComponents, vectorsPerChunk))
+			pfn(numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, streaming);
+		else
+			convertToAOSOAGeneric(numComponents, numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, vectorsPerChunk, streaming);
+
+		// Make the non-temporal stores visible before anything that follows
+		if (streaming)
+			_mm_sfence();
+	}
+
+	static void convertToAOSOAAVX(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk,
+		bool streaming)
+	{
+		if (auto pfn = pickKernel<ConvertToAOSOAAVX>(numComponents, vectorsPerChunk))
+			pfn(numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, streaming);
+		else
+			convertToAOSOAGeneric(numComponents, numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, vectorsPerChunk, streaming);
+
+		// Make the non-temporal stores visible before anything that follows
+		if (streaming)
+			_mm_sfence();
+	}
+
+	static void convertFromAOSOASSE(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk)
+	{
+		if (auto pfn = pickKernel<ConvertFromAOSOASSE>(numComponents, vectorsPerChunk))
+			pfn(numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes);
+		else
+			convertFromAOSOAGeneric(numComponents, numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, vectorsPerChunk);
+	}
+
+	static void convertFromAOSOAAVX(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk)
+	{
+		if (auto pfn = pickKernel<ConvertFromAOSOAAVX>(numComponents, vectorsPerChunk))
+			pfn(numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes);
+		else
+			convertFromAOSOAGeneric(numComponents, numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, vectorsPerChunk);
+	}
+
+
+
+	// Batch vector operations.  These load a chunk's worth of tightly packed input vectors at
+	// a time and transpose them to AOSOA in registers, as in the conversion kernels above, then
+	// do the math on the whole chunk at once.  The last chunk uses partial loads and stores.
+
+	// Load 4 AOS vectors as an SSE chunk
+	template <int nc>
+	inline vector<__m128, nc> loadAOSChunkSSE(const float * p)
+	{
+		__m128 r[4];
+		for (int k = 0; k < 4; ++k)
+			r[k] = loadAOSVector<nc>(p + nc*k, false);
+
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+		vector<__m128, nc> result;
+		for (int j = 0; j < nc; ++j)
+			result[j] = r[j];
+		return result;
+	}
+
+	// For 3-component vectors, 4 of them fit exactly in 3 registers, which can then be
+	// deinterleaved with fewer shuffles than a 4x4 transpose
+	inline void deinterleave3(__m128 m0, __m128 m1, __m128 m2, vector<__m128, 3> * pChunkOut)
+	{
+		__m128 yz01 = _mm_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));		// y0 z0 y1 z1
+		__m128 xy23 = _mm_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));		// x2 y2 x3 y3
+		pChunkOut->x = _mm_shuffle_ps(m0, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+		pChunkOut->y = _mm_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+		pChunkOut->z = _mm_shuffle_ps(yz01, m2, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+	inline void deinterleave3(__m256 m0, __m256 m1, __m256 m2, vector<__m256, 3> * pChunkOut)
+	{
+		__m256 yz01 = _mm256_shuffle_ps(m0, m1, _MM_SHUFFLE(1, 0, 2, 1));
+		__m256 xy23 = _mm256_shuffle_ps(m1, m2, _MM_SHUFFLE(2, 1, 3, 2));
+		pChunkOut->x = _mm256_shuffle_ps(m0, xy23, _MM_SHUFFLE(2, 0, 3, 0));
+		pChunkOut->y = _mm256_shuffle_ps(yz01, xy23, _MM_SHUFFLE(3, 1, 2, 0));
+		pChunkOut->z = _mm256_shuffle_ps(yz01, m2, _MM_SHUFFLE(3, 0, 3, 1));
+	}
+
+	template <>
+	inline vector<__m128, 3> loadAOSChunkSSE<3>(const float * p)
+	{
+		vector<__m128, 3> result;
+		deinterleave3(_mm_loadu_ps(p), _mm_loadu_ps(p + 4), _mm_loadu_ps(p + 8), &result);
+		return result;
+	}
+
+	// Load the last count (1 to 4) AOS vectors in the array as an SSE chunk; missing vectors
+	// are zero
+	template <int nc>
+	inline vector<__m128, nc> loadAOSChunkSSE(const float * p, int count)
+	{
+		__m128 r[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			if (k < count)
+				r[k] = loadAOSVector<nc>(p + nc*k, k == count - 1);
+			else
+				r[k] = _mm_setzero_ps();
+		}
+
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+
+		vector<__m128, nc> result;
+		for (int j = 0; j < nc; ++j)
+			result[j] = r[j];
+		return result;
+	}
+
+	// Load 8 AOS vectors as an AVX chunk
+	template <int nc>
+	inline vector<__m256, nc> loadAOSChunkAVX(const float * p)
+	{
+		__m256 r[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			__m128 low = loadAOSVector<nc>(p + nc*k, false);
+			__m128 high = loadAOSVector<nc>(p + nc*(k + 4), false);
+			r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(low), high, 1);
+		}
+
+		transpose4x4Halves(r[0], r[1], r[2], r[3]);
+
+		vector<__m256, nc> result;
+		for (int j = 0; j < nc; ++j)
+			result[j] = r[j];
+		return result;
+	}
+
+	template <>
+	inline vector<__m256, 3> loadAOSChunkAVX<3>(const float * p)
+	{
+		// Vectors 0-3 go in the low halves of the registers and 4-7 in the high halves
+		__m256 m0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p)), _mm_loadu_ps(p + 12), 1);
+		__m256 m1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 4)), _mm_loadu_ps(p + 16), 1);
+		__m256 m2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(p + 8)), _mm_loadu_ps(p + 20), 1);
+		vector<__m256, 3> result;
+		deinterleave3(m0, m1, m2, &result);
+		return result;
+	}
+
+	// Load the last count (1 to 8) AOS vectors in the array as an AVX chunk; missing vectors
+	// are zero
+	template <int nc>
+	inline vector<__m256, nc> loadAOSChunkAVX(const float * p, int count)
+	{
+		__m128 v[8];
+		for (int k = 0; k < 8; ++k)
+		{
+			if (k < count)
+				v[k] = loadAOSVector<nc>(p + nc*k, k == count - 1);
+			else
+				v[k] = _mm_setzero_ps();
+		}
+
+		__m256 r[4];
+		for (int k = 0; k < 4; ++k)
+			r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(v[k]), v[k + 4], 1);
+
+		transpose4x4Halves(r[0], r[1], r[2], r[3]);
+
+		vector<__m256, nc> result;
+		for (int j = 0; j < nc; ++j)
+			result[j] = r[j];
+		return result;
+	}
+
+	// Multiply-add for the kernels.  ENABLE_FMA only decides what the inline operators in the
+	// headers compile to, but the AVX-level kernels only ever run on CPUs with FMA3 (see
+	// detectISA()), so they always fuse; the SSE-level ones go through fma(), so they fuse
+	// only if it's on.  kernelFma128 is for AVX-level kernels working on 4-wide vectors.
+	inline __m128 kernelFma(__m128 a, __m128 b, __m128 c)
+		{ return fma(a, b, c); }
+	inline __m256 kernelFma(__m256 a, __m256 b, __m256 c)
+		{ return _mm256_fmadd_ps(a, b, c); }
+	inline __m128 kernelFma128(__m128 a, __m128 b, __m128 c)
+		{ return _mm_fmadd_ps(a, b, c); }
+
+	template <typename T, int n>
+	inline T kernelDot(vector<T, n> const & a, vector<T, n> const & b)
+	{
+		T result = a[0] * b[0];
+		for (int i = 1; i < n; ++i)
+			result = kernelFma(a[i], b[i], result);
+		return result;
+	}
+
+	template <int nc>
+	struct BatchKernelsSSE
+	{
+		static void dot(int numVectors, const float * pA, const float * pB, float * pOut)
+		{
+			// The last chunk is always done separately, since it needs exact loads
+			int i = 0;
+			for (; i + 4 < numVectors; i += 4)
+				_mm_storeu_ps(pOut + i, kernelDot(loadAOSChunkSSE<nc>(pA + nc*i), loadAOSChunkSSE<nc>(pB + nc*i)));
+
+			if (int count = numVectors - i)
+				storePartial(pOut + i, kernelDot(loadAOSChunkSSE<nc>(pA + nc*i, count), loadAOSChunkSSE<nc>(pB + nc*i, count)), count);
+		}
+
+		static void length(int numVectors, const float * pA, float * pOut)
+		{
+			int i = 0;
+			for (; i + 4 < numVectors; i += 4)
+			{
+				vector<__m128, nc> a = loadAOSChunkSSE<nc>(pA + nc*i);
+				_mm_storeu_ps(pOut + i, sqrt(kernelDot(a, a)));
+			}
+
+			if (int count = numVectors - i)
+			{
+				vector<__m128, nc> a = loadAOSChunkSSE<nc>(pA + nc*i, count);
+				storePartial(pOut + i, sqrt(kernelDot(a, a)), count);
+			}
+		}
+	};
+
+	template <int nc>
+	struct BatchKernelsAVX
+	{
+		static void dot(int numVectors, const float * pA, const float * pB, float * pOut)
+		{
+			// The last chunk is always done separately, since it needs exact loads
+			int i = 0;
+			for (; i + 8 < numVectors; i += 8)
+				_mm256_storeu_ps(pOut + i, kernelDot(loadAOSChunkAVX<nc>(pA + nc*i), loadAOSChunkAVX<nc>(pB + nc*i)));
+
+			if (int count = numVectors - i)
+				storePartial(pOut + i, kernelDot(loadAOSChunkAVX<nc>(pA + nc*i, count), loadAOSChunkAVX<nc>(pB + nc*i, count)), count);
+
+			_mm256_zeroupper();
+		}
+
+		static void length(int numVectors, const float * pA, float * pOut)
+		{
+			int i = 0;
+			for (; i + 8 < numVectors; i += 8)
+			{
+				vector<__m256, nc> a = loadAOSChunkAVX<nc>(pA + nc*i);
+				_mm256_storeu_ps(pOut + i, sqrt(kernelDot(a, a)));
+			}
+
+			if (int count = numVectors - i)
+			{
+				vector<__m256, nc> a = loadAOSChunkAVX<nc>(pA + nc*i, count);
+				storePartial(pOut + i, sqrt(kernelDot(a, a)), count);
+			}
+
+			_mm256_zeroupper();
+		}
+	};
+
+
+
+	// Batch transforms of 3D points and vectors.  These work like the batch operations above,
+	// but the input and output can have any stride (e.g. for positions in a vertex buffer).
+	// When both are tightly packed, full chunks use the cheaper 3-component (de)interleave.
+
+	enum XBM		// Xfm Batch Mode
+	{
+		XBM_Point,			// xfmPoint by an affine
+		XBM_Vector,			// xfmVector by an affine (or a 3x3 padded out to one)
+		XBM_Project,		// Transform by a full 4x4 matrix, then divide by w
+
+		XBM_Count
+	};
+
+	// Inverse of deinterleave3
+	inline void interleave3(vector<__m128, 3> chunk, __m128 * pM0Out, __m128 * pM1Out, __m128 * pM2Out)
+	{
+		__m128 xy01 = _mm_unpacklo_ps(chunk.x, chunk.y);										// x0 y0 x1 y1
+		__m128 xy23 = _mm_unpackhi_ps(chunk.x, chunk.y);										// x2 y2 x3 y3
+		__m128 zx01 = _mm_shuffle_ps(chunk.z, chunk.x, _MM_SHUFFLE(1, 1, 0, 0));				// z0 z0 x1 x1
+		__m128 yz1 = _mm_shuffle_ps(chunk.y, chunk.z, _MM_SHUFFLE(1, 1, 1, 1));				// y1 y1 z1 z1
+		__m128 zxy3 = _mm_shuffle_ps(chunk.z, xy23, _MM_SHUFFLE(3, 2, 3, 2));				// z2 z3 x3 y3
+		*pM0Out = _mm_shuffle_ps(xy01, zx01, _MM_SHUFFLE(2, 0, 1, 0));
+		*pM1Out = _mm_shuffle_ps(yz1, xy23, _MM_SHUFFLE(1, 0, 2, 0));
+		*pM2Out = _mm_shuffle_ps(zxy3, zxy3, _MM_SHUFFLE(1, 3, 2, 0));
+	}
+	inline void interleave3(vector<__m256, 3> chunk, __m256 * pM0Out, __m256 * pM1Out, __m256 * pM2Out)
+	{
+		__m256 xy01 = _mm256_unpacklo_ps(chunk.x, chunk.y);
+		__m256 xy23 = _mm256_unpackhi_ps(chunk.x, chunk.y);
+		__m256 zx01 = _mm256_shuffle_ps(chunk.z, chunk.x, _MM_SHUFFLE(1, 1, 0, 0));
+		__m256 yz1 = _mm256_shuffle_ps(chunk.y, chunk.z, _MM_SHUFFLE(1, 1, 1, 1));
+		__m256 zxy3 = _mm256_shuffle_ps(chunk.z, xy23, _MM_SHUFFLE(3, 2, 3, 2));
+		*pM0Out = _mm256_shuffle_ps(xy01, zx01, _MM_SHUFFLE(2, 0, 1, 0));
+		*pM1Out = _mm256_shuffle_ps(yz1, xy23, _MM_SHUFFLE(1, 0, 2, 0));
+		*pM2Out = _mm256_shuffle_ps(zxy3, zxy3, _MM_SHUFFLE(1, 3, 2, 0));
+	}
+
+	// Load or store 4 or 8 tightly packed AOS 3-vectors as a chunk
+	inline void loadAOSChunk(const float * p, vector<__m128, 3> * pChunkOut)
+		{ *pChunkOut = loadAOSChunkSSE<3>(p); }
+	inline void loadAOSChunk(const float * p, vector<__m256, 3> * pChunkOut)
+		{ *pChunkOut = loadAOSChunkAVX<3>(p); }
+	inline void storeAOSChunk(float * p, vector<__m128, 3> chunk)
+	{
+		__m128 m0, m1, m2;
+		interleave3(chunk, &m0, &m1, &m2);
+		_mm_storeu_ps(p, m0);
+		_mm_storeu_ps(p + 4, m1);
+		_mm_storeu_ps(p + 8, m2);
+	}
+	inline void storeAOSChunk(float * p, vector<__m256, 3> chunk)
+	{
+		// Vectors 0-3 are in the low halves of the registers and 4-7 in the high halves
+		__m256 m0, m1, m2;
+		interleave3(chunk, &m0, &m1, &m2);
+		_mm_storeu_ps(p, _mm256_castps256_ps128(m0));
+		_mm_storeu_ps(p + 4, _mm256_castps256_ps128(m1));
+		_mm_storeu_ps(p + 8, _mm256_castps256_ps128(m2));
+		_mm_storeu_ps(p + 12, _mm256_extractf128_ps(m0, 1));
+		_mm_storeu_ps(p + 16, _mm256_extractf128_ps(m1, 1));
+		_mm_storeu_ps(p + 20, _mm256_extractf128_ps(m2, 1));
+	}
+
+	// Load up to 4 AOS 3-vectors at any stride as an SSE chunk; missing vectors are zero.
+	// If last is set, the last vector loaded is assumed to be the end of the array.
+	inline void loadAOSChunkStrided(const void * p, int strideBytes, int count, bool last, vector<__m128, 3> * pChunkOut)
+	{
+		__m128 r[4];
+		for (int k = 0; k < 4; ++k)
+		{
+			if (k < count)
+				r[k] = loadAOSVector<3>((const float *)offsetPtr(p, k * strideBytes), last && k == count - 1);
+			else
+				r[k] = _mm_setzero_ps();
+		}
+
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		*pChunkOut = vector<__m128, 3>(r[0], r[1], r[2]);
+	}
+
+	// Load up to 8 AOS 3-vectors at any stride as an AVX chunk
+	inline void loadAOSChunkStrided(const void * p, int strideBytes, int count, bool last, vector<__m256, 3> * pChunkOut)
+	{
+		__m128 v[8];
+		for (int k = 0; k < 8; ++k)
+		{
+			if (k < count)
+				v[k] = loadAOSVector<3>((const float *)offsetPtr(p, k * strideBytes), last && k == count - 1);
+			else
+				v[k] = _mm_setzero_ps();
+		}
+
+		__m256 r[4];
+		for (int k = 0; k < 4; ++k)
+			r[k] = _mm256_insertf128_ps(_mm256_castps128_ps256(v[k]), v[k + 4], 1);
+
+		transpose4x4Halves(r[0], r[1], r[2], r[3]);
+		*pChunkOut = vector<__m256, 3>(r[0], r[1], r[2]);
+	}
+
+	// Store the first count vectors of a chunk to AOS 3-vectors at any stride
+	inline void storeAOSChunkStrided(void * p, int strideBytes, vector<__m128, 3> chunk, int count)
+	{
+		__m128 r[4] = { chunk.x, chunk.y, chunk.z, _mm_setzero_ps(), };
+		_MM_TRANSPOSE4_PS(r[0], r[1], r[2], r[3]);
+		for (int k = 0; k < 4; ++k)
+		{
+			if (k < count)
+				storeAOSVector<3>((float *)offsetPtr(p, k * strideBytes), r[k]);
+		}
+	}
+	inline void storeAOSChunkStrided(void * p, int strideBytes, vector<__m256, 3> chunk, int count)
+	{
+		__m256 r[4] = { chunk.x, chunk.y, chunk.z, _mm256_setzero_ps(), };
+		transpose4x4Halves(r[0], r[1], r[2], r[3]);
+		for (int k = 0; k < 8; ++k)
+		{
+			if (k < count)
+			{
+				__m128 v = (k < 4) ? _mm256_castps256_ps128(r[k]) : _mm256_extractf128_ps(r[k - 4], 1);
+				storeAOSVector<3>((float *)offsetPtr(p, k * strideBytes), v);
+			}
+		}
+	}
+
+	// xfmPoint or xfmVector, written out with kernelFma
+	template <typename T>
+	inline vector<T, 3> xfmChunk(vector<T, 3> a, matrix<T, 4, 4> const & m, XBM mode)
+	{
+		vector<T, 3> result;
+		for (int j = 0; j < 3; ++j)
+		{
+			T sum = (mode == XBM_Vector) ? a.z * m[2][j] : kernelFma(a.z, m[2][j], m[3][j]);
+			result[j] = kernelFma(a.x, m[0][j], kernelFma(a.y, m[1][j], sum));
+		}
+		if (mode == XBM_Project)
+		{
+			// Divide by the w component
+			T w = kernelFma(a.x, m[0][3], kernelFma(a.y, m[1][3], kernelFma(a.z, m[2][3], m[3][3])));
+			result = result * (splat<T>(1.0f) / w);
+		}
+		return result;
+	}
+
+	template <typename T, XBM mode>
+	inline void xfmBatch(int numVectors, const void * pInput, int inputStrideBytes, void * pOutput, int outputStrideBytes, float4x4 const & xfm)
+	{
+		const int W = sizeof(T) / sizeof(float);
+
+		matrix<T, 4, 4> m;
+		for (int i = 0; i < 16; ++i)
+			m.data[i] = splat<T>(xfm.data[i]);
+
+		// The last chunk is always done separately, since it needs exact loads
+		int i = 0;
+		vector<T, 3> a;
+		if (inputStrideBytes == sizeof(float3) && outputStrideBytes == sizeof(float3))
+		{
+			for (; i + W < numVectors; i += W)
+			{
+				loadAOSChunk((const float *)pInput + 3*i, &a);
+				storeAOSChunk((float *)pOutput + 3*i, xfmChunk(a, m, mode));
+			}
+		}
+		else
+		{
+			for (; i + W < numVectors; i += W)
+			{
+				loadAOSChunkStrided(offsetPtr(pInput, ptrdiff_t(i) * inputStrideBytes), inputStrideBytes, W, false, &a);
+				storeAOSChunkStrided(offsetPtr(pOutput, ptrdiff_t(i) * outputStrideBytes), outputStrideBytes, xfmChunk(a, m, mode), W);
+			}
+		}
+
+		if (int count = numVectors - i)
+		{
+			loadAOSChunkStrided(offsetPtr(pInput, ptrdiff_t(i) * inputStrideBytes), inputStrideBytes, count, true, &a);
+			storeAOSChunkStrided(offsetPtr(pOutput, ptrdiff_t(i) * outputStrideBytes), outputStrideBytes, xfmChunk(a, m, mode), count);
+		}
+	}
+
+	template <XBM mode>
+	static void xfmBatchSSE(int numVectors, const void * pInput, int inputStrideBytes, void * pOutput, int outputStrideBytes, float4x4 const & xfm)
+	{
+		xfmBatch<__m128, mode>(numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, xfm);
+	}
+
+	template <XBM mode>
+	static void xfmBatchAVX(int numVectors, const void * pInput, int inputStrideBytes, void * pOutput, int outputStrideBytes, float4x4 const & xfm)
+	{
+		xfmBatch<__m256, mode>(numVectors, pInput, inputStrideBytes, pOutput, outputStrideBytes, xfm);
+		_mm256_zeroupper();
+	}
+
+
+
+	// Batch applyQuat: rotate 4 (SSE) or 8 (AVX) vectors at a time, by one quat splatted to
+	// all lanes or by a chunk of quats loaded alongside the vectors
+
+	// Load 4 or 8 quats as a chunk, with components in w, x, y, z order; or the last count of
+	// them in the array, with the missing ones zero
+	inline void loadQuatChunk(const quat * p, vector<__m128, 4> * pChunkOut)
+		{ *pChunkOut = loadAOSChunkSSE<4>(p->data); }
+	inline void loadQuatChunk(const quat * p, vector<__m256, 4> * pChunkOut)
+		{ *pChunkOut = loadAOSChunkAVX<4>(p->data); }
+	inline void loadQuatChunk(const quat * p, int count, vector<__m128, 4> * pChunkOut)
+		{ *pChunkOut = loadAOSChunkSSE<4>(p->data, count); }
+	inline void loadQuatChunk(const quat * p, int count, vector<__m256, 4> * pChunkOut)
+		{ *pChunkOut = loadAOSChunkAVX<4>(p->data, count); }
+
+	// Same math as the scalar applyQuat
+	template <typename T>
+	inline vector<T, 3> applyQuatChunk(vector<T, 4> const & q, vector<T, 3> v)
+	{
+		// Written out per component; the generic cross() compiles to noticeably worse AVX code
+		T tx = q[2]*v.z - q[3]*v.y;
+		T ty = q[3]*v.x - q[1]*v.z;
+		T tz = q[1]*v.y - q[2]*v.x;
+		tx = tx + tx;
+		ty = ty + ty;
+		tz = tz + tz;
+		return vector<T, 3>(
+			kernelFma(q[0], tx, v.x) + (q[2]*tz - q[3]*ty),
+			kernelFma(q[0], ty, v.y) + (q[3]*tx - q[1]*tz),
+			kernelFma(q[0], tz, v.z) + (q[1]*ty - q[2]*tx));
+	}
+
+	template <typename T>
+	inline void applyQuatBatch(int numVectors, const quat * pQuats, bool perVector, const float3 * pInput, float3 * pOutput)
+	{
+		const int W = sizeof(T) / sizeof(float);
+
+		vector<T, 4> q;
+		if (!perVector)
+		{
+			for (int j = 0; j < 4; ++j)
+				q[j] = splat<T>(pQuats->data[j]);
+		}
+
+		// The last chunk is always done separately, since it needs exact loads
+		int i = 0;
+		vector<T, 3> v;
+		for (; i + W < numVectors; i += W)
+		{
+			if (perVector)
+				loadQuatChunk(pQuats + i, &q);
+			loadAOSChunk(&pInput[i].x, &v);
+			storeAOSChunk(&pOutput[i].x, applyQuatChunk(q, v));
+		}
+
+		if (int count = numVectors - i)
+		{
+			if (perVector)
+				loadQuatChunk(pQuats + i, count, &q);
+			loadAOSChunkStrided(pInput + i, sizeof(float3), count, true, &v);
+			storeAOSChunkStrided(pOutput + i, sizeof(float3), applyQuatChunk(q, v), count);
+		}
+	}
+
+	static void applyQuatBatchSSE(int numVectors, const quat * pQuats, bool perVector, const float3 * pInput, float3 * pOutput)
+	{
+		applyQuatBatch<__m128>(numVectors, pQuats, perVector, pInput, pOutput);
+	}
+	static void applyQuatBatchAVX(int numVectors, const quat * pQuats, bool perVector, const float3 * pInput, float3 * pOutput)
+	{
+		applyQuatBatch<__m256>(numVectors, pQuats, perVector, pInput, pOutput);
+		_mm256_zeroupper();
+	}
+
+
+
+	// Batch 4x4 matrix operations.  Each group of 4 (SSE) or 8 (AVX) matrices is transposed so
+	// that each lane holds one matrix, with the same 4x4 transposes as the AOSOA conversion.
+	// The last group, if partial, goes through a buffer padded out with identity matrices.
+
+	inline void loadMatrixChunk(const float4x4 * p, matrix<__m128, 4, 4> * pChunkOut)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128 r0 = _mm_loadu_ps(&p[0].data[i*4]);
+			__m128 r1 = _mm_loadu_ps(&p[1].data[i*4]);
+			__m128 r2 = _mm_loadu_ps(&p[2].data[i*4]);
+			__m128 r3 = _mm_loadu_ps(&p[3].data[i*4]);
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			(*pChunkOut)[i][0] = r0;
+			(*pChunkOut)[i][1] = r1;
+			(*pChunkOut)[i][2] = r2;
+			(*pChunkOut)[i][3] = r3;
+		}
+	}
+	inline void loadMatrixChunk(const float4x4 * p, matrix<__m256, 4, 4> * pChunkOut)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			// Matrices 0-3 go in the low halves of the registers and 4-7 in the high halves
+			__m256 r0 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&p[0].data[i*4])), _mm_loadu_ps(&p[4].data[i*4]), 1);
+			__m256 r1 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&p[1].data[i*4])), _mm_loadu_ps(&p[5].data[i*4]), 1);
+			__m256 r2 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&p[2].data[i*4])), _mm_loadu_ps(&p[6].data[i*4]), 1);
+			__m256 r3 = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(&p[3].data[i*4])), _mm_loadu_ps(&p[7].data[i*4]), 1);
+			transpose4x4Halves(r0, r1, r2, r3);
+			(*pChunkOut)[i][0] = r0;
+			(*pChunkOut)[i][1] = r1;
+			(*pChunkOut)[i][2] = r2;
+			(*pChunkOut)[i][3] = r3;
+		}
+	}
+
+	inline void storeMatrixChunk(float4x4 * p, matrix<__m128, 4, 4> const & chunk)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			__m128 r0 = chunk[i][0], r1 = chunk[i][1], r2 = chunk[i][2], r3 = chunk[i][3];
+			_MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+			_mm_storeu_ps(&p[0].data[i*4], r0);
+			_mm_storeu_ps(&p[1].data[i*4], r1);
+			_mm_storeu_ps(&p[2].data[i*4], r2);
+			_mm_storeu_ps(&p[3].data[i*4], r3);
+		}
+	}
+	inline void storeMatrixChunk(float4x4 * p, matrix<__m256, 4, 4> const & chunk)
+	{
+		for (int i = 0; i < 4; ++i)
+		{
+			__m256 r0 = chunk[i][0], r1 = chunk[i][1], r2 = chunk[i][2], r3 = chunk[i][3];
+			transpose4x4Halves(r0, r1, r2, r3);
+			_mm_storeu_ps(&p[0].data[i*4], _mm256_castps256_ps128(r0));
+			_mm_storeu_ps(&p[1].data[i*4], _mm256_castps256_ps128(r1));
+			_mm_storeu_ps(&p[2].data[i*4], _mm256_castps256_ps128(r2));
+			_mm_storeu_ps(&p[3].data[i*4], _mm256_castps256_ps128(r3));
+			_mm_storeu_ps(&p[4].data[i*4], _mm256_extractf128_ps(r0, 1));
+			_mm_storeu_ps(&p[5].data[i*4], _mm256_extractf128_ps(r1, 1));
+			_mm_storeu_ps(&p[6].data[i*4], _mm256_extractf128_ps(r2, 1));
+			_mm_storeu_ps(&p[7].data[i*4], _mm256_extractf128_ps(r3, 1));
+		}
+	}
+
+	template <typename T>
+	inline void inverseBatch(int numMatrices, const float4x4 * pMatrices, float4x4 * pInversesOut, bool * pSingularOut, float epsilon)
+	{
+		const int W = sizeof(T) / sizeof(float);
+		matrix<T, 4, 4> chunk;
+		float4x4 buffer[W];
+		for (int i = 0; i < numMatrices; i += W)
+		{
+			int count = min(numMatrices - i, W);
+			if (count == W)
+				loadMatrixChunk(pMatrices + i, &chunk);
+			else
+			{
+				for (int k = 0; k < W; ++k)
+					buffer[k] = (k < count) ? pMatrices[i + k] : float4x4(identity);
+				loadMatrixChunk(buffer, &chunk);
+			}
+
+			lanemask invertible = movemask(tryInvertMatrix(chunk, &chunk, epsilon));
+
+			if (count == W)
+				storeMatrixChunk(pInversesOut + i, chunk);
+			else
+			{
+				storeMatrixChunk(buffer, chunk);
+				for (int k = 0; k < count; ++k)
+					pInversesOut[i + k] = buffer[k];
+			}
+
+			if (pSingularOut)
+			{
+				for (int k = 0; k < count; ++k)
+					pSingularOut[i + k] = !(invertible & (1 << k));
+			}
+		}
+	}
+
+	template <typename T>
+	inline void determinantBatch(int numMatrices, const float4x4 * pMatrices, float * pDeterminantsOut)
+	{
+		const int W = sizeof(T) / sizeof(float);
+		matrix<T, 4, 4> chunk;
+		float4x4 buffer[W];
+		for (int i = 0; i < numMatrices; i += W)
+		{
+			int count = min(numMatrices - i, W);
+			if (count == W)
+				loadMatrixChunk(pMatrices + i, &chunk);
+			else
+			{
+				for (int k = 0; k < W; ++k)
+					buffer[k] = (k < count) ? pMatrices[i + k] : float4x4(identity);
+				loadMatrixChunk(buffer, &chunk);
+			}
+			storePartial(pDeterminantsOut + i, determinant(chunk), count);
+		}
+	}
+
+	static void inverseBatchSSE(int numMatrices, const float4x4 * pMatrices, float4x4 * pInversesOut, bool * pSingularOut, float epsilon)
+	{
+		inverseBatch<__m128>(numMatrices, pMatrices, pInversesOut, pSingularOut, epsilon);
+	}
+	static void inverseBatchAVX(int numMatrices, const float4x4 * pMatrices, float4x4 * pInversesOut, bool * pSingularOut, float epsilon)
+	{
+		inverseBatch<__m256>(numMatrices, pMatrices, pInversesOut, pSingularOut, epsilon);
+		_mm256_zeroupper();
+	}
+	static void determinantBatchSSE(int numMatrices, const float4x4 * pMatrices, float * pDeterminantsOut)
+	{
+		determinantBatch<__m128>(numMatrices, pMatrices, pDeterminantsOut);
+	}
+	static void determinantBatchAVX(int numMatrices, const float4x4 * pMatrices, float * pDeterminantsOut)
+	{
+		determinantBatch<__m256>(numMatrices, pMatrices, pDeterminantsOut);
+		_mm256_zeroupper();
+	}
+
+	// Load or store a chunk of up to 4 or 8 3x3 matrices, a row at a time through the strided
+	// AOS 3-vector accessors.  If last is set, the chunk ends the array.
+	template <typename T>
+	inline void loadMatrixChunk(const float3x3 * p, int count, bool last, matrix<T, 3, 3> * pChunkOut)
+	{
+		vector<T, 3> row;
+		for (int r = 0; r < 3; ++r)
+		{
+			loadAOSChunkStrided(&p->data[3*r], sizeof(float3x3), count, last && r == 2, &row);
+			(*pChunkOut)[r] = row;
+		}
+	}
+	template <typename T>
+	inline void storeMatrixChunk(float3x3 * p, matrix<T, 3, 3> const & chunk, int count)
+	{
+		for (int r = 0; r < 3; ++r)
+			storeAOSChunkStrided(&p->data[3*r], sizeof(float3x3), chunk[r], count);
+	}
+
+	template <typename T>
+	inline void eigenSymmetricBatch(int numMatrices, const float3x3 * pMatrices, float3 * pEigenvaluesOut, float3x3 * pEigenvectorsOut)
+	{
+		const int W = sizeof(T) / sizeof(float);
+		matrix<T, 3, 3> chunk;
+		vector<T, 3> eigenvalues;
+		for (int i = 0; i < numMatrices; i += W)
+		{
+			int count = min(numMatrices - i, W);
+			loadMatrixChunk(pMatrices + i, count, i + W >= numMatrices, &chunk);
+
+			// Padding lanes are zero matrices, which come out as zero eigenvalues
+			eigenDecomposeSymmetric(chunk, &eigenvalues, &chunk);
+
+			if (pEigenvaluesOut)
+				storeAOSChunkStrided(pEigenvaluesOut + i, sizeof(float3), eigenvalues, count);
+			if (pEigenvectorsOut)
+				storeMatrixChunk(pEigenvectorsOut + i, chunk, count);
+		}
+	}
+
+	static void eigenSymmetricBatchSSE(int numMatrices, const float3x3 * pMatrices, float3 * pEigenvaluesOut, float3x3 * pEigenvectorsOut)
+	{
+		eigenSymmetricBatch<__m128>(numMatrices, pMatrices, pEigenvaluesOut, pEigenvectorsOut);
+	}
+	static void eigenSymmetricBatchAVX(int numMatrices, const float3x3 * pMatrices, float3 * pEigenvaluesOut, float3x3 * pEigenvectorsOut)
+	{
+		eigenSymmetricBatch<__m256>(numMatrices, pMatrices, pEigenvaluesOut, pEigenvectorsOut);
+		_mm256_zeroupper();
+	}
+
+
+
+	// Dense matrix products, for dmatrix<float>.  The output is computed in tiles of up to 4
+	// rows by two lanes' worth of columns, whose sums stay in registers (8 accumulators) over
+	// the whole loop along k.  The rows of b that a tile reads are packed into a panel first,
+	// so that loop reads memory consecutively; the panel is sized to stay in L2 while the rows
+	// of a stream past it.  The dmatrix row padding lets the tiles run past the last column
+	// without special cases: it's zero in b, so the padding in the output stays zero too.
+
+	static const int s_gemmPanelDepth = 256;	// Rows of b per panel
+	static const int s_gemmPanelWidth = 256;	// Columns of b per panel; a multiple of the tile width
+	static const int s_gemmTileRows = 4;
+
+	// Aligned and unaligned loads and stores of whole lanes, for the kernels templated on lane type
+	template <typename T> T loadAligned(const float * p);
+	template <> inline __m128 loadAligned<__m128>(const float * p) { return _mm_load_ps(p); }
+	template <> inline __m256 loadAligned<__m256>(const float * p) { return _mm256_load_ps(p); }
+	template <typename T> T loadUnaligned(const float * p);
+	template <> inline __m128 loadUnaligned<__m128>(const float * p) { return _mm_loadu_ps(p); }
+	template <> inline __m256 loadUnaligned<__m256>(const float * p) { return _mm256_loadu_ps(p); }
+	inline void storeAligned(float * p, __m128 a) { _mm_store_ps(p, a); }
+	inline void storeAligned(float * p, __m256 a) { _mm256_store_ps(p, a); }
+
+	// Pack a depth x width block of b into strips two lanes wide, each stored row after row
+	template <typename T>
+	inline void gemmPackPanel(int depth, int width, const float * pB, int strideB, float * pPanelOut)
+	{
+		const int W = sizeof(T) / sizeof(float);
+		for (int j = 0; j < width; j += 2*W)
+		{
+			for (int k = 0; k < depth; ++k)
+			{
+				storeAligned(pPanelOut, loadAligned<T>(pB + k*strideB + j));
+				storeAligned(pPanelOut + W, loadAligned<T>(pB + k*strideB + j + W));
+				pPanelOut += 2*W;
+			}
+		}
+	}
+
+	// Accumulate a band of rows of the output against every strip of a panel
+	template <typename T, int rows>
+	inline void gemmBand(int depth, int width, const float * pA, int strideA, const float * pPanel, float * pC, int strideC)
+	{
+		const int W = sizeof(T) / sizeof(float);
+		for (int j = 0; j < width; j += 2*W, pPanel += 2*W*depth)
+		{
+			T acc[rows][2];
+			for (int i = 0; i < rows; ++i)
+				acc[i][0] = acc[i][1] = splat<T>(0.0f);
+
+			for (int k = 0; k < depth; ++k)
+			{
+				T b0 = loadAligned<T>(pPanel + 2*W*k);
+				T b1 = loadAligned<T>(pPanel + 2*W*k + W);
+				for (int i = 0; i < rows; ++i)
+				{
+					T aik = splat<T>(pA[i*strideA + k]);
+					acc[i][0] = kernelFma(aik, b0, acc[i][0]);
+					acc[i][1] = kernelFma(aik, b1, acc[i][1]);
+				}
+			}
+
+			for (int i = 0; i < rows; ++i)
+			{
+				float * pTile = pC + i*strideC + j;
+				storeAligned(pTile, loadAligned<T>(pTile) + acc[i][0]);
+				storeAligned(pTile + W, loadAligned<T>(pTile + W) + acc[i][1]);
+			}
+		}
+	}
+
+	// Accumulate c += a * b, for numRows rows of a and c.  a is numRows x depth, b is
+	// depth x width, and all the rows are aligned and padded as in dmatrix.
+	template <typename T>
+	inline void gemm(int numRows, int depth, int width, const float * pA, int strideA, const float * pB, int strideB, float * pC, int strideC)
+	{
+		const int W = sizeof(T) / sizeof(float);
+		int widthPadded = roundUp(width, 2*W);
+
+		float * pPanel = (float *)_mm_malloc(s_gemmPanelDepth * s_gemmPanelWidth * sizeof(float), 64);
+		for (int k0 = 0; k0 < depth; k0 += s_gemmPanelDepth)
+		{
+			int panelDepth = min(depth - k0, s_gemmPanelDepth);
+			for (int j0 = 0; j0 < widthPadded; j0 += s_gemmPanelWidth)
+			{
+				int panelWidth = min(widthPadded - j0, s_gemmPanelWidth);
+				gemmPackPanel<T>(panelDepth, panelWidth, pB + k0*strideB + j0, strideB, pPanel);
+
+				for (int i = 0; i < numRows; i += s_gemmTileRows)
+				{
+					const float * pABand = pA + i*strideA + k0;
+					float * pCBand = pC + i*strideC + j0;
+					switch (min(numRows - i, s_gemmTileRows))
+					{
+					case 1:		gemmBand<T, 1>(panelDepth, panelWidth, pABand, strideA, pPanel, pCBand, strideC); break;
+					case 2:		gemmBand<T, 2>(panelDepth, panelWidth, pABand, strideA, pPanel, pCBand, strideC); break;
+					case 3:		gemmBand<T, 3>(panelDepth, panelWidth, pABand, strideA, pPanel, pCBand, strideC); break;
+					default:	gemmBand<T, 4>(panelDepth, panelWidth, pABand, strideA, pPanel, pCBand, strideC); break;
+					}
+				}
+			}
+		}
+		_mm_free(pPanel);
+	}
+
+	// Matrix times vector, y = a * x.  The rows of a are aligned and padded; x is unaligned,
+	// and only its first width elements are read.
+	template <typename T>
+	inline void gemv(int numRows, int width, const float * pA, int strideA, const float * pX, float * pY)
+	{
+		const int W = sizeof(T) / sizeof(float);
+		for (int i = 0; i < numRows; ++i)
+		{
+			const float * pRow = pA + i*strideA;
+			T sum0 = splat<T>(0.0f), sum1 = splat<T>(0.0f);
+			int j = 0;
+			for (; j + 2*W <= width; j += 2*W)
+			{
+				sum0 = kernelFma(loadAligned<T>(pRow + j), loadUnaligned<T>(pX + j), sum0);
+				sum1 = kernelFma(loadAligned<T>(pRow + j + W), loadUnaligned<T>(pX + j + W), sum1);
+			}
+			for (; j < width; j += W)
+				sum0 = kernelFma(loadAligned<T>(pRow + j), loadPartial<T>(pX + j, min(width - j, W)), sum0);
+			pY[i] = horizontalSum(sum0 + sum1);
+		}
+	}
+
+	static void gemmSSE(int numRows, int depth, int width, const float * pA, int strideA, const float * pB, int strideB, float * pC, int strideC)
+	{
+		gemm<__m128>(numRows, depth, width, pA, strideA, pB, strideB, pC, strideC);
+	}
+	static void gemmAVX(int numRows, int depth, int width, const float * pA, int strideA, const float * pB, int strideB, float * pC, int strideC)
+	{
+		gemm<__m256>(numRows, depth, width, pA, strideA, pB, strideB, pC, strideC);
+		_mm256_zeroupper();
+	}
+	static void gemvSSE(int numRows, int width, const float * pA, int strideA, const float * pX, float * pY)
+	{
+		gemv<__m128>(numRows, width, pA, strideA, pX, pY);
+	}
+	static void gemvAVX(int numRows, int width, const float * pA, int strideA, const float * pX, float * pY)
+	{
+		gemv<__m256>(numRows, width, pA, strideA, pX, pY);
+		_mm256_zeroupper();
+	}
+
+
+
+	// Sparse matrix times vector, for csrmatrix<float> and csrmatrix<float3x3>.  With scalar
+	// entries, each row is done a lane's worth of entries at a time, gathering the x values
+	// they multiply (in hardware with AVX2), and the lanes are summed at the end of the row.
+	// With 3x3 blocks, each block row is multiplied componentwise by x and accumulated in its
+	// own register; the three registers are transposed and summed once at the end of the row.
+
+	static void spmvSSE(int numRows, const int * pRowStarts, const int * pColumns, const float * pValues, const float * pX, float * pY)
+	{
+		for (int i = 0; i < numRows; ++i)
+		{
+			int k = pRowStarts[i], kEnd = pRowStarts[i + 1];
+			__m128 sum = _mm_setzero_ps();
+			for (; k + 4 <= kEnd; k += 4)
+			{
+				__m128 x = _mm_setr_ps(pX[pColumns[k]], pX[pColumns[k + 1]], pX[pColumns[k + 2]], pX[pColumns[k + 3]]);
+				sum = kernelFma(_mm_loadu_ps(pValues + k), x, sum);
+			}
+			float result = horizontalSum(sum);
+			for (; k < kEnd; ++k)
+				result += pValues[k] * pX[pColumns[k]];
+			pY[i] = result;
+		}
+	}
+
+	static void spmvAVX(int numRows, const int * pRowStarts, const int * pColumns, const float * pValues, const float * pX, float * pY)
+	{
+		for (int i = 0; i < numRows; ++i)
+		{
+			int k = pRowStarts[i], kEnd = pRowStarts[i + 1];
+			__m256 sum = _mm256_setzero_ps();
+			for (; k + 8 <= kEnd; k += 8)
+			{
+				__m256i columns = _mm256_loadu_si256((const __m256i *)(pColumns + k));
+				sum = kernelFma(_mm256_loadu_ps(pValues + k), _mm256_i32gather_ps(pX, columns, 4), sum);
+			}
+			if (int count = kEnd - k)
+			{
+				// Masked loads and gather for the rest of the row
+				__m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+				__m256i columns = _mm256_maskload_epi32(pColumns + k, mask);
+				__m256 x = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), pX, columns, _mm256_castsi256_ps(mask), 4);
+				sum = kernelFma(_mm256_maskload_ps(pValues + k, mask), x, sum);
+			}
+			pY[i] = horizontalSum(sum);
+		}
+		_mm256_zeroupper();
+	}
+
+	template <__m128 (*madd)(__m128, __m128, __m128)>
+	inline void spmvBlock3(int numRows, const int * pRowStarts, const int * pColumns, const float3x3 * pBlocks, const float3 * pX, int numX, float3 * pY)
+	{
+		for (int i = 0; i < numRows; ++i)
+		{
+			// The w lanes pick up garbage, but they end up in the row of the transpose that's
+			// thrown away
+			__m128 sum0 = _mm_setzero_ps(), sum1 = _mm_setzero_ps(), sum2 = _mm_setzero_ps(), sum3 = _mm_setzero_ps();
+			for (int k = pRowStarts[i]; k < pRowStarts[i + 1]; ++k)
+			{
+				int col = pColumns[k];
+				__m128 x = loadAOSVector<3>((const float *)&pX[col], col == numX - 1);
+				const float * pBlock = pBlocks[k].data;
+				sum0 = madd(_mm_loadu_ps(pBlock), x, sum0);
+				sum1 = madd(_mm_loadu_ps(pBlock + 3), x, sum1);
+
+				// Load the last row from one float earlier, so as not to read past the block,
+				// then rotate it into place
+				__m128 row2 = _mm_loadu_ps(pBlock + 5);
+				sum2 = madd(_mm_shuffle_ps(row2, row2, _MM_SHUFFLE(0, 3, 2, 1)), x, sum2);
+			}
+			_MM_TRANSPOSE4_PS(sum0, sum1, sum2, sum3);
+			storeAOSVector<3>((float *)&pY[i], sum0 + sum1 + sum2);
+		}
+	}
+
+	static void spmvBlock3SSE(int numRows, const int * pRowStarts, const int * pColumns, const float3x3 * pBlocks, const float3 * pX, int numX, float3 * pY)
+	{
+		spmvBlock3<&kernelFma>(numRows, pRowStarts, pColumns, pBlocks, pX, numX, pY);
+	}
+	static void spmvBlock3AVX(int numRows, const int * pRowStarts, const int * pColumns, const float3x3 * pBlocks, const float3 * pX, int numX, float3 * pY)
+	{
+		spmvBlock3<&kernelFma128>(numRows, pRowStarts, pColumns, pBlocks, pX, numX, pY);
+	}
+
+
+
+	// Dispatch table for out-of-line kernels, with one entry per ISA level.
+	// Levels with no specialized version of a given kernel just use the next level down.
+
+	typedef void (*ConvertToAOSOAKernel)(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk,
+		bool streaming);
+
+	typedef void (*ConvertFromAOSOAKernel)(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk);
+
+	typedef void (*DotBatchKernel)(int numVectors, const float * pA, const float * pB, float * pOut);
+	typedef void (*LengthBatchKernel)(int numVectors, const float * pA, float * pOut);
+	typedef void (*XfmBatchKernel)(int numVectors, const void * pInput, int inputStrideBytes, void * pOutput, int outputStrideBytes, float4x4 const & xfm);
+	typedef void (*ApplyQuatBatchKernel)(int numVectors, const quat * pQuats, bool perVector, const float3 * pInput, float3 * pOutput);
+	typedef void (*InverseBatchKernel)(int numMatrices, const float4x4 * pMatrices, float4x4 * pInversesOut, bool * pSingularOut, float epsilon);
+	typedef void (*DeterminantBatchKernel)(int numMatrices, const float4x4 * pMatrices, float * pDeterminantsOut);
+	typedef void (*EigenBatchKernel)(int numMatrices, const float3x3 * pMatrices, float3 * pEigenvaluesOut, float3x3 * pEigenvectorsOut);
+	typedef void (*GemmKernel)(int numRows, int depth, int width, const float * pA, int strideA, const float * pB, int strideB, float * pC, int strideC);
+	typedef void (*GemvKernel)(int numRows, int width, const float * pA, int strideA, const float * pX, float * pY);
+	typedef void (*SpmvKernel)(int numRows, const int * pRowStarts, const int * pColumns, const float * pValues, const float * pX, float * pY);
+	typedef void (*SpmvBlock3Kernel)(int numRows, const int * pRowStarts, const int * pColumns, const float3x3 * pBlocks, const float3 * pX, int numX, float3 * pY);
+
+	struct SIMDKernels
+	{
+		ConvertToAOSOAKernel	pfnConvertToAOSOA;
+		ConvertFromAOSOAKernel	pfnConvertFromAOSOA;
+		DotBatchKernel			pfnDotBatch[3];			// Indexed by numComponents - 2
+		LengthBatchKernel		pfnLengthBatch[3];		// Indexed by numComponents - 2
+		XfmBatchKernel			pfnXfmBatch[XBM_Count];
+		ApplyQuatBatchKernel	pfnApplyQuatBatch;
+		InverseBatchKernel		pfnInverseBatch;
+		DeterminantBatchKernel	pfnDeterminantBatch;
+		EigenBatchKernel		pfnEigenBatch;
+		GemmKernel				pfnGemm;
+		GemvKernel				pfnGemv;
+		SpmvKernel				pfnSpmv;
+		SpmvBlock3Kernel		pfnSpmvBlock3;
+	};
+
+	static const SIMDKernels s_kernels[] =
+	{
+		// ISA_SSE2
+		{
+			&convertToAOSOASSE,
+			&convertFromAOSOASSE,
+			{ &BatchKernelsSSE<2>::dot, &BatchKernelsSSE<3>::dot, &BatchKernelsSSE<4>::dot, },
+			{ &BatchKernelsSSE<2>::length, &BatchKernelsSSE<3>::length, &BatchKernelsSSE<4>::length, },
+			{ &xfmBatchSSE<XBM_Point>, &xfmBatchSSE<XBM_Vector>, &xfmBatchSSE<XBM_Project>, },
+			&applyQuatBatchSSE,
+			&inverseBatchSSE,
+			&determinantBatchSSE,
+			&eigenSymmetricBatchSSE,
+			&gemmSSE,
+			&gemvSSE,
+			&spmvSSE,
+			&spmvBlock3SSE,
+		},
+		// ISA_AVX2
+		{
+			&convertToAOSOAAVX,
+			&convertFromAOSOAAVX,
+			{ &BatchKernelsAVX<2>::dot, &BatchKernelsAVX<3>::dot, &BatchKernelsAVX<4>::dot, },
+			{ &BatchKernelsAVX<2>::length, &BatchKernelsAVX<3>::length, &BatchKernelsAVX<4>::length, },
+			{ &xfmBatchAVX<XBM_Point>, &xfmBatchAVX<XBM_Vector>, &xfmBatchAVX<XBM_Project>, },
+			&applyQuatBatchAVX,
+			&inverseBatchAVX,
+			&determinantBatchAVX,
+			&eigenSymmetricBatchAVX,
+			&gemmAVX,
+			&gemvAVX,
+			&spmvAVX,
+			&spmvBlock3AVX,
+		},
+		// ISA_AVX512
+		{
+			&convertToAOSOAAVX,
+			&convertFromAOSOAAVX,
+			{ &BatchKernelsAVX<2>::dot, &BatchKernelsAVX<3>::dot, &BatchKernelsAVX<4>::dot, },
+			{ &BatchKernelsAVX<2>::length, &BatchKernelsAVX<3>::length, &BatchKernelsAVX<4>::length, },
+			{ &xfmBatchAVX<XBM_Point>, &xfmBatchAVX<XBM_Vector>, &xfmBatchAVX<XBM_Project>, },
+			&applyQuatBatchAVX,
+			&inverseBatchAVX,
+			&determinantBatchAVX,
+			&eigenSymmetricBatchAVX,
+			&gemmAVX,
+			&gemvAVX,
+			&spmvAVX,
+			&spmvBlock3AVX,
+		},
+	};
+	cassert(dim(s_kernels) == ISA_Count);
+
+	static const SIMDKernels & kernels()
+	{
+		return s_kernels[currentISA()];
+	}
+
+
+
+	// Public entry points: validate arguments, then dispatch
+
+	size_t g_aosoaStreamingThresholdBytes = 16 * 1024 * 1024;
+
+	void convertToAOSOA(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk /*= 4*/,
+		AOSOAM mode /*= AOSOAM_Auto*/)
+	{
+		ASSERT_ERR(numComponents > 0);
+		ASSERT_ERR(pInput);
+		ASSERT_ERR(inputStrideBytes >= sizeof(float) * numComponents);
+		ASSERT_ERR(pOutput);
+		ASSERT_ERR((size_t)pOutput % (vectorsPerChunk * sizeof(float)) == 0);
+		ASSERT_ERR(outputStrideBytes >= vectorsPerChunk * sizeof(float) * numComponents);
+
+		bool streaming;
+		switch (mode)
+		{
+		case AOSOAM_Cached:		streaming = false; break;
+		case AOSOAM_Streaming:	streaming = true; break;
+		default:
+			{
+				size_t numChunks = (numVectors + vectorsPerChunk - 1) / vectorsPerChunk;
+				streaming = (numChunks * outputStrideBytes >= g_aosoaStreamingThresholdBytes);
+			}
+			break;
+		}
+
+		kernels().pfnConvertToAOSOA(
+			numComponents, numVectors,
+			pInput, inputStrideBytes,
+			pOutput, outputStrideBytes,
+			vectorsPerChunk, streaming);
+	}
+
+	void convertFromAOSOA(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk /*= 4*/)
+	{
+		ASSERT_ERR(numComponents > 0);
+		ASSERT_ERR(pInput);
+		ASSERT_ERR((size_t)pInput % (vectorsPerChunk * sizeof(float)) == 0);
+		ASSERT_ERR(inputStrideBytes >= vectorsPerChunk * sizeof(float) * numComponents);
+		ASSERT_ERR(pOutput);
+		ASSERT_ERR(outputStrideBytes >= sizeof(float) * numComponents);
+
+		kernels().pfnConvertFromAOSOA(
+			numComponents, numVectors,
+			pInput, inputStrideBytes,
+			pOutput, outputStrideBytes,
+			vectorsPerChunk);
+	}
+
+	template <int n>
+	static void dotBatchImpl(array<const vector<float, n>> a, array<const vector<float, n>> b, array<float> dotsOut)
+	{
+		ASSERT_ERR(a.size == b.size);
+		ASSERT_ERR(dotsOut.size >= a.size);
+
+		kernels().pfnDotBatch[n - 2](int(a.size), (const float *)a.data, (const float *)b.data, dotsOut.data);
+	}
+
+	template <int n>
+	static void lengthBatchImpl(array<const vector<float, n>> a, array<float> lengthsOut)
+	{
+		ASSERT_ERR(lengthsOut.size >= a.size);
+
+		kernels().pfnLengthBatch[n - 2](int(a.size), (const float *)a.data, lengthsOut.data);
+	}
+
+	void dotBatch(array<const float2> a, array<const float2> b, array<float> dotsOut)
+		{ dotBatchImpl(a, b, dotsOut); }
+	void dotBatch(array<const float3> a, array<const float3> b, array<float> dotsOut)
+		{ dotBatchImpl(a, b, dotsOut); }
+	void dotBatch(array<const float4> a, array<const float4> b, array<float> dotsOut)
+		{ dotBatchImpl(a, b, dotsOut); }
+	void lengthBatch(array<const float2> a, array<float> lengthsOut)
+		{ lengthBatchImpl(a, lengthsOut); }
+	void lengthBatch(array<const float3> a, array<float> lengthsOut)
+		{ lengthBatchImpl(a, lengthsOut); }
+	void lengthBatch(array<const float4> a, array<float> lengthsOut)
+		{ lengthBatchImpl(a, lengthsOut); }
+
+	// Minimum number of vectors per thread for the batch transforms, so that the cost of
+	// starting a thread is small compared to the work it does
+	static const size_t s_xfmBatchMinVectorsPerThread = 16 * 1024;
+
+	static void xfmBatchImpl(
+		XBM mode,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		float4x4 const & xfm,
+		int numThreads)
+	{
+		ASSERT_ERR(numVectors >= 0);
+		ASSERT_ERR(pInput || numVectors == 0);
+		ASSERT_ERR(inputStrideBytes >= sizeof(float3));
+		ASSERT_ERR(pOutput || numVectors == 0);
+		ASSERT_ERR(outputStrideBytes >= sizeof(float3));
+
+		XfmBatchKernel pfnKernel = kernels().pfnXfmBatch[mode];
+		parallelFor(
+			numVectors, numThreads, s_xfmBatchMinVectorsPerThread,
+			[=, &xfm](size_t start, size_t end)
+			{
+				pfnKernel(
+					int(end - start),
+					offsetPtr(pInput, ptrdiff_t(start) * inputStrideBytes), inputStrideBytes,
+					offsetPtr(pOutput, ptrdiff_t(start) * outputStrideBytes), outputStrideBytes,
+					xfm);
+			});
+	}
+
+	void xfmPointBatch(array<const float3> points, affine3 const & xfm, array<float3> pointsOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(pointsOut.size >= points.size);
+		xfmBatchImpl(XBM_Point, int(points.size), points.data, sizeof(float3), pointsOut.data, sizeof(float3), xfm, numThreads);
+	}
+	void xfmVectorBatch(array<const float3> vectors, affine3 const & xfm, array<float3> vectorsOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(vectorsOut.size >= vectors.size);
+		xfmBatchImpl(XBM_Vector, int(vectors.size), vectors.data, sizeof(float3), vectorsOut.data, sizeof(float3), xfm, numThreads);
+	}
+	void xfmVectorBatch(array<const float3> vectors, float3x3 const & xfm, array<float3> vectorsOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(vectorsOut.size >= vectors.size);
+		xfmBatchImpl(XBM_Vector, int(vectors.size), vectors.data, sizeof(float3), vectorsOut.data, sizeof(float3), affine3(xfm), numThreads);
+	}
+	void projectPointBatch(array<const float3> points, float4x4 const & xfm, array<float3> pointsOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(pointsOut.size >= points.size);
+		xfmBatchImpl(XBM_Project, int(points.size), points.data, sizeof(float3), pointsOut.data, sizeof(float3), xfm, numThreads);
+	}
+
+	void xfmPointBatch(int numPoints, const void * pPoints, int inputStrideBytes, affine3 const & xfm, void * pPointsOut, int outputStrideBytes, int numThreads /*= 1*/)
+		{ xfmBatchImpl(XBM_Point, numPoints, pPoints, inputStrideBytes, pPointsOut, outputStrideBytes, xfm, numThreads); }
+	void xfmVectorBatch(int numVectors, const void * pVectors, int inputStrideBytes, affine3 const & xfm, void * pVectorsOut, int outputStrideBytes, int numThreads /*= 1*/)
+		{ xfmBatchImpl(XBM_Vector, numVectors, pVectors, inputStrideBytes, pVectorsOut, outputStrideBytes, xfm, numThreads); }
+	void xfmVectorBatch(int numVectors, const void * pVectors, int inputStrideBytes, float3x3 const & xfm, void * pVectorsOut, int outputStrideBytes, int numThreads /*= 1*/)
+		{ xfmBatchImpl(XBM_Vector, numVectors, pVectors, inputStrideBytes, pVectorsOut, outputStrideBytes, affine3(xfm), numThreads); }
+	void projectPointBatch(int numPoints, const void * pPoints, int inputStrideBytes, float4x4 const & xfm, void * pPointsOut, int outputStrideBytes, int numThreads /*= 1*/)
+		{ xfmBatchImpl(XBM_Project, numPoints, pPoints, inputStrideBytes, pPointsOut, outputStrideBytes, xfm, numThreads); }
+
+	static void applyQuatBatchImpl(int numVectors, const quat * pQuats, bool perVector, const float3 * pInput, float3 * pOutput, int numThreads)
+	{
+		ApplyQuatBatchKernel pfnKernel = kernels().pfnApplyQuatBatch;
+		parallelFor(
+			numVectors, numThreads, s_xfmBatchMinVectorsPerThread,
+			[=](size_t start, size_t end)
+			{
+				pfnKernel(int(end - start), perVector ? pQuats + start : pQuats, perVector, pInput + start, pOutput + start);
+			});
+	}
+
+	void applyQuatBatch(quat q, array<const float3> vectors, array<float3> vectorsOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(vectorsOut.size >= vectors.size);
+		applyQuatBatchImpl(int(vectors.size), &q, false, vectors.data, vectorsOut.data, numThreads);
+	}
+	void applyQuatBatch(array<const quat> quats, array<const float3> vectors, array<float3> vectorsOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(quats.size >= vectors.size);
+		ASSERT_ERR(vectorsOut.size >= vectors.size);
+		applyQuatBatchImpl(int(vectors.size), quats.data, true, vectors.data, vectorsOut.data, numThreads);
+	}
+
+	void inverseBatch(array<const float4x4> matrices, array<float4x4> inversesOut, array<bool> singularOut /*= array<bool>()*/, float epsilon /*= util::epsilon*/)
+	{
+		ASSERT_ERR(inversesOut.size >= matrices.size);
+		ASSERT_ERR(singularOut.size == 0 || singularOut.size >= matrices.size);
+
+		kernels().pfnInverseBatch(int(matrices.size), matrices.data, inversesOut.data, singularOut.data, epsilon);
+	}
+
+	void determinantBatch(array<const float4x4> matrices, array<float> determinantsOut)
+	{
+		ASSERT_ERR(determinantsOut.size >= matrices.size);
+
+		kernels().pfnDeterminantBatch(int(matrices.size), matrices.data, determinantsOut.data);
+	}
+
+	// Minimum number of matrices per thread for the batch eigendecomposition
+	static const size_t s_eigenBatchMinMatricesPerThread = 4 * 1024;
+
+	void eigenDecomposeSymmetricBatch(array<const float3x3> matrices, array<float3> eigenvaluesOut, array<float3x3> eigenvectorsOut /*= array<float3x3>()*/, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(eigenvaluesOut.size == 0 || eigenvaluesOut.size >= matrices.size);
+		ASSERT_ERR(eigenvectorsOut.size == 0 || eigenvectorsOut.size >= matrices.size);
+
+		EigenBatchKernel pfnKernel = kernels().pfnEigenBatch;
+		parallelFor(
+			matrices.size, numThreads, s_eigenBatchMinMatricesPerThread,
+			[=](size_t start, size_t end)
+			{
+				pfnKernel(
+					int(end - start),
+					matrices.data + start,
+					eigenvaluesOut.data ? eigenvaluesOut.data + start : nullptr,
+					eigenvectorsOut.data ? eigenvectorsOut.data + start : nullptr);
+			});
+	}
+
+	// Minimum number of output rows per thread for the dmatrix products
+	static const size_t s_gemmMinRowsPerThread = 64;
+	static const size_t s_gemvMinRowsPerThread = 1024;
+
+	void multiply(dmatrix<float> const & a, dmatrix<float> const & b, dmatrix<float> * pOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(a.cols == b.rows);
+		ASSERT_ERR(pOut && pOut != &a && pOut != &b);
+
+		pOut->resize(a.rows, b.cols);
+		GemmKernel pfnKernel = kernels().pfnGemm;
+		float * pC = pOut->data;
+		int strideC = pOut->stride;
+		parallelFor(
+			a.rows, numThreads, s_gemmMinRowsPerThread,
+			[=, &a, &b](size_t start, size_t end)
+			{
+				pfnKernel(
+					int(end - start), a.cols, b.cols,
+					a.data + start * a.stride, a.stride,
+					b.data, b.stride,
+					pC + start * strideC, strideC);
+			});
+	}
+
+	void multiply(dmatrix<float> const & a, array<const float> x, array<float> yOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(x.size >= size_t(a.cols));
+		ASSERT_ERR(yOut.size >= size_t(a.rows));
+		ASSERT_ERR(!impl::overlaps(yOut.data, a.rows, a.data, size_t(a.rows) * a.stride));
+		ASSERT_ERR(!impl::overlaps(yOut.data, a.rows, x.data, a.cols));
+
+		GemvKernel pfnKernel = kernels().pfnGemv;
+		parallelFor(
+			a.rows, numThreads, s_gemvMinRowsPerThread,
+			[=, &a](size_t start, size_t end)
+			{
+				pfnKernel(int(end - start), a.cols, a.data + start * a.stride, a.stride, x.data, yOut.data + start);
+			});
+	}
+
+	// Minimum number of rows per thread for the sparse matrix products
+	static const size_t s_spmvMinRowsPerThread = 4096;
+
+	void multiply(csrmatrix<float> const & a, array<const float> x, array<float> yOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(x.size >= size_t(a.cols));
+		ASSERT_ERR(yOut.size >= size_t(a.rows()));
+		ASSERT_ERR(x.data != yOut.data);
+
+		SpmvKernel pfnKernel = kernels().pfnSpmv;
+		parallelFor(
+			a.rows(), numThreads, s_spmvMinRowsPerThread,
+			[=, &a](size_t start, size_t end)
+			{
+				pfnKernel(int(end - start), a.rowStarts.data + start, a.columns.data, a.values.data, x.data, yOut.data + start);
+			});
+	}
+
+	void multiply(csrmatrix<float3x3> const & a, array<const float3> x, array<float3> yOut, int numThreads /*= 1*/)
+	{
+		ASSERT_ERR(x.size >= size_t(a.cols));
+		ASSERT_ERR(yOut.size >= size_t(a.rows()));
+		ASSERT_ERR(x.data != yOut.data);
+
+		SpmvBlock3Kernel pfnKernel = kernels().pfnSpmvBlock3;
+		parallelFor(
+			a.rows(), numThreads, s_spmvMinRowsPerThread,
+			[=, &a](size_t start, size_t end)
+			{
+				pfnKernel(int(end - start), a.rowStarts.data + start, a.columns.data, a.values.data, x.data, int(x.size), yOut.data + start);
+			});
+	}
 }
@@ -1,5 +1,17 @@
 #pragma once
-#include <emmintrin.h>
+#include <immintrin.h>
+
+// SSE4.1 instructions (blendv, pmulld, pminsd/pmaxsd) can be used in the inline SSE code by
+// #defining ENABLE_SSE41 to 1 or 0.  If not defined, it's on when compiling for AVX or above
+// (MSVC has no switch for SSE4.1 alone).  The out-of-line kernels are dispatched at runtime
+// instead; see detectISA().
+#ifndef ENABLE_SSE41
+#	if defined(__AVX__) || defined(__SSE4_1__)
+#		define ENABLE_SSE41 1
+#	else
+#		define ENABLE_SSE41 0
+#	endif
+#endif
 
 namespace util
 {
@@ -305,6 +317,9 @@ namespace util
 
 	inline __m128i operator * (__m128i a, __m128i b)
 	{
+#if ENABLE_SSE41
+		return _mm_mullo_epi32(a, b);
+#else
 		// Note: there's no 32-bit int multiply in SSE2 (there is in SSE4.1).
 		// This sequence of shuffles and 64-bit muls emulates it, as seen here:
 		// http://stackoverflow.com/questions/10500766/sse-multiplication-of-4-32-bit-integers
@@ -313,6 +328,7 @@ namespace util
 		return _mm_unpacklo_epi32(
 					_mm_shuffle_epi32(tmp1, _MM_SHUFFLE(0,0,2,0)),
 					_mm_shuffle_epi32(tmp2, _MM_SHUFFLE(0,0,2,0)));
+#endif
 	}
 	inline __m128i operator * (int a, __m128i b)
 	{
@@ -324,7 +340,8 @@ namespace util
 	}
 
 	// Note: there's no 32-bit integer divide in SSE2.  Could maybe emulate it, or
-	// approximate it by converting to float and dividing.
+	// approximate it by converting to float and dividing.  For division by the same
+	// value many times, see divisor below.
 #if 0
 	inline __m128i operator / (__m128i a, __m128i b)
 	{
@@ -556,60 +573,2228 @@ namespace util
 	}
 
 
-	
-	// Convert memory layouts to and from SIMD-friendly AOSOA layout
 
-	// convertToAOSOA takes a layout like this:
-	//   xyz...xyz...xyz...xyz...
-	// and makes it look like this:
-	//   xxxxyyyyzzzz...xxxxyyyyzzzz...
-	// In other words, it groups vectors in chunks, and stores each chunk in SOA layout.
-	// Components (xyz) are always assumed to be 32 bits each (float or int).
-    // Both input and output layouts can have an arbitrary stride, but the components of each
-	// individual vector are assumed to be tightly packed.
-	// numComponents is the count of components per vector (e.g. 3 for xyz, 4 for xyzw).
-	// numVectors is the count of vectors (each xyz or xyzw).  If this is not a multiple of the,
-	// chunk size, the last chunk in the output array will be zero-padded to fill it out.
-	// vectorsPerChunk is the number of vectors per chunk. Usually 4 for SSE, 8 for AVX.
+	// Overloaded operators for __m256 (AVX), so it can be used in vectors
 
-	void convertToAOSOA(
-		int numComponents,
-		int numVectors,
-		const void * pInput,
-		int inputStrideBytes,
-		void * pOutput,
-		int outputStrideBytes,
-		int vectorsPerChunk = 4);
+	inline __m256 operator + (__m256 a, __m256 b)
+	{
+		return _mm256_add_ps(a, b);
+	}
+	inline __m256 operator + (float a, __m256 b)
+	{
+		return _mm256_add_ps(_mm256_set1_ps(a), b);
+	}
+	inline __m256 operator + (__m256 a, float b)
+	{
+		return _mm256_add_ps(a, _mm256_set1_ps(b));
+	}
 
-	// convertFromAOSOA does the inverse of convertToAOSOA.
+	inline __m256 operator - (__m256 a, __m256 b)
+	{
+		return _mm256_sub_ps(a, b);
+	}
+	inline __m256 operator - (float a, __m256 b)
+	{
+		return _mm256_sub_ps(_mm256_set1_ps(a), b);
+	}
+	inline __m256 operator - (__m256 a, float b)
+	{
+		return _mm256_sub_ps(a, _mm256_set1_ps(b));
+	}
 
-	void convertFromAOSOA(
-		int numComponents,
-		int numVectors,
-		const void * pInput,
-		int inputStrideBytes,
-		void * pOutput,
-		int outputStrideBytes,
-		int vectorsPerChunk = 4);
+	inline __m256 operator - (__m256 a)
+	{
+		return _mm256_sub_ps(_mm256_setzero_ps(), a);
+	}
 
+	inline __m256 operator * (__m256 a, __m256 b)
+	{
+		return _mm256_mul_ps(a, b);
+	}
+	inline __m256 operator * (float a, __m256 b)
+	{
+		return _mm256_mul_ps(_mm256_set1_ps(a), b);
+	}
+	inline __m256 operator * (__m256 a, float b)
+	{
+		return _mm256_mul_ps(a, _mm256_set1_ps(b));
+	}
 
+	inline __m256 operator / (__m256 a, __m256 b)
+	{
+		return _mm256_div_ps(a, b);
+	}
+	inline __m256 operator / (float a, __m256 b)
+	{
+		return _mm256_div_ps(_mm256_set1_ps(a), b);
+	}
+	inline __m256 operator / (__m256 a, float b)
+	{
+		return _mm256_div_ps(a, _mm256_set1_ps(b));
+	}
+
+	inline __m256 operator & (__m256 a, __m256 b)
+	{
+		return _mm256_and_ps(a, b);
+	}
+	inline __m256 operator & (float a, __m256 b)
+	{
+		return _mm256_and_ps(_mm256_set1_ps(a), b);
+	}
+	inline __m256 operator & (__m256 a, float b)
+	{
+		return _mm256_and_ps(a, _mm256_set1_ps(b));
+	}
+
+	inline __m256 operator | (__m256 a, __m256 b)
+	{
+		return _mm256_or_ps(a, b);
+	}
+	inline __m256 operator | (float a, __m256 b)
+	{
+		return _mm256_or_ps(_mm256_set1_ps(a), b);
+	}
+	inline __m256 operator | (__m256 a, float b)
+	{
+		return _mm256_or_ps(a, _mm256_set1_ps(b));
+	}
+
+	inline __m256 operator ^ (__m256 a, __m256 b)
+	{
+		return _mm256_xor_ps(a, b);
+	}
+	inline __m256 operator ^ (float a, __m256 b)
+	{
+		return _mm256_xor_ps(_mm256_set1_ps(a), b);
+	}
+	inline __m256 operator ^ (__m256 a, float b)
+	{
+		return _mm256_xor_ps(a, _mm256_set1_ps(b));
+	}
+
+	inline __m256 operator ! (__m256 a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm256_andnot_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(~0)));
+	}
+
+	inline __m256 operator ~ (__m256 a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm256_andnot_ps(a, _mm256_castsi256_ps(_mm256_set1_epi32(~0)));
+	}
+
+	inline __m256 & operator += (__m256 & a, __m256 b)
+	{
+		a = a + b;
+		return a;
+	}
+	inline __m256 & operator += (__m256 & a, float b)
+	{
+		a = a + b;
+		return a;
+	}
+
+	inline __m256 & operator -= (__m256 & a, __m256 b)
+	{
+		a = a - b;
+		return a;
+	}
+	inline __m256 & operator -= (__m256 & a, float b)
+	{
+		a = a - b;
+		return a;
+	}
+
+	inline __m256 & operator *= (__m256 & a, __m256 b)
+	{
+		a = a * b;
+		return a;
+	}
+	inline __m256 & operator *= (__m256 & a, float b)
+	{
+		a = a * b;
+		return a;
+	}
+
+	inline __m256 & operator /= (__m256 & a, __m256 b)
+	{
+		a = a / b;
+		return a;
+	}
+	inline __m256 & operator /= (__m256 & a, float b)
+	{
+		a = a / b;
+		return a;
+	}
+
+	inline __m256 & operator &= (__m256 & a, __m256 b)
+	{
+		a = a & b;
+		return a;
+	}
+	inline __m256 & operator &= (__m256 & a, float b)
+	{
+		a = a & b;
+		return a;
+	}
+
+	inline __m256 & operator |= (__m256 & a, __m256 b)
+	{
+		a = a | b;
+		return a;
+	}
+	inline __m256 & operator |= (__m256 & a, float b)
+	{
+		a = a | b;
+		return a;
+	}
+
+	inline __m256 & operator ^= (__m256 & a, __m256 b)
+	{
+		a = a ^ b;
+		return a;
+	}
+	inline __m256 & operator ^= (__m256 & a, float b)
+	{
+		a = a ^ b;
+		return a;
+	}
+
+	inline __m256 operator == (__m256 a, __m256 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_EQ_OQ);
+	}
+	inline __m256 operator == (float a, __m256 b)
+	{
+		return _mm256_cmp_ps(_mm256_set1_ps(a), b, _CMP_EQ_OQ);
+	}
+	inline __m256 operator == (__m256 a, float b)
+	{
+		return _mm256_cmp_ps(a, _mm256_set1_ps(b), _CMP_EQ_OQ);
+	}
+
+	inline __m256 operator != (__m256 a, __m256 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_NEQ_UQ);
+	}
+	inline __m256 operator != (float a, __m256 b)
+	{
+		return _mm256_cmp_ps(_mm256_set1_ps(a), b, _CMP_NEQ_UQ);
+	}
+	inline __m256 operator != (__m256 a, float b)
+	{
+		return _mm256_cmp_ps(a, _mm256_set1_ps(b), _CMP_NEQ_UQ);
+	}
+
+	inline __m256 operator < (__m256 a, __m256 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+	}
+	inline __m256 operator < (float a, __m256 b)
+	{
+		return _mm256_cmp_ps(_mm256_set1_ps(a), b, _CMP_LT_OQ);
+	}
+	inline __m256 operator < (__m256 a, float b)
+	{
+		return _mm256_cmp_ps(a, _mm256_set1_ps(b), _CMP_LT_OQ);
+	}
+
+	inline __m256 operator > (__m256 a, __m256 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_GT_OQ);
+	}
+	inline __m256 operator > (float a, __m256 b)
+	{
+		return _mm256_cmp_ps(_mm256_set1_ps(a), b, _CMP_GT_OQ);
+	}
+	inline __m256 operator > (__m256 a, float b)
+	{
+		return _mm256_cmp_ps(a, _mm256_set1_ps(b), _CMP_GT_OQ);
+	}
+
+	inline __m256 operator <= (__m256 a, __m256 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+	}
+	inline __m256 operator <= (float a, __m256 b)
+	{
+		return _mm256_cmp_ps(_mm256_set1_ps(a), b, _CMP_LE_OQ);
+	}
+	inline __m256 operator <= (__m256 a, float b)
+	{
+		return _mm256_cmp_ps(a, _mm256_set1_ps(b), _CMP_LE_OQ);
+	}
+
+	inline __m256 operator >= (__m256 a, __m256 b)
+	{
+		return _mm256_cmp_ps(a, b, _CMP_GE_OQ);
+	}
+	inline __m256 operator >= (float a, __m256 b)
+	{
+		return _mm256_cmp_ps(_mm256_set1_ps(a), b, _CMP_GE_OQ);
+	}
+	inline __m256 operator >= (__m256 a, float b)
+	{
+		return _mm256_cmp_ps(a, _mm256_set1_ps(b), _CMP_GE_OQ);
+	}
+
+
+
+	// Overloaded operators for __m256i (AVX2), so it can be used in vectors
+
+	inline __m256i operator + (__m256i a, __m256i b)
+	{
+		return _mm256_add_epi32(a, b);
+	}
+	inline __m256i operator + (int a, __m256i b)
+	{
+		return _mm256_add_epi32(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator + (__m256i a, int b)
+	{
+		return _mm256_add_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	inline __m256i operator - (__m256i a, __m256i b)
+	{
+		return _mm256_sub_epi32(a, b);
+	}
+	inline __m256i operator - (int a, __m256i b)
+	{
+		return _mm256_sub_epi32(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator - (__m256i a, int b)
+	{
+		return _mm256_sub_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	inline __m256i operator - (__m256i a)
+	{
+		return _mm256_sub_epi32(_mm256_setzero_si256(), a);
+	}
+
+	inline __m256i operator * (__m256i a, __m256i b)
+	{
+		// Note: unlike SSE2, AVX2 does have a 32-bit int multiply (keeping the low 32 bits).
+		return _mm256_mullo_epi32(a, b);
+	}
+	inline __m256i operator * (int a, __m256i b)
+	{
+		return _mm256_mullo_epi32(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator * (__m256i a, int b)
+	{
+		return _mm256_mullo_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	// Note: there's no 32-bit integer divide in AVX2 either.
+
+	inline __m256i operator & (__m256i a, __m256i b)
+	{
+		return _mm256_and_si256(a, b);
+	}
+	inline __m256i operator & (int a, __m256i b)
+	{
+		return _mm256_and_si256(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator & (__m256i a, int b)
+	{
+		return _mm256_and_si256(a, _mm256_set1_epi32(b));
+	}
+
+	inline __m256i operator | (__m256i a, __m256i b)
+	{
+		return _mm256_or_si256(a, b);
+	}
+	inline __m256i operator | (int a, __m256i b)
+	{
+		return _mm256_or_si256(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator | (__m256i a, int b)
+	{
+		return _mm256_or_si256(a, _mm256_set1_epi32(b));
+	}
+
+	inline __m256i operator ^ (__m256i a, __m256i b)
+	{
+		return _mm256_xor_si256(a, b);
+	}
+	inline __m256i operator ^ (int a, __m256i b)
+	{
+		return _mm256_xor_si256(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator ^ (__m256i a, int b)
+	{
+		return _mm256_xor_si256(a, _mm256_set1_epi32(b));
+	}
+
+	inline __m256i operator ! (__m256i a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm256_andnot_si256(a, _mm256_set1_epi32(~0));
+	}
+
+	inline __m256i operator ~ (__m256i a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm256_andnot_si256(a, _mm256_set1_epi32(~0));
+	}
+
+	inline __m256i & operator += (__m256i & a, __m256i b)
+	{
+		a = a + b;
+		return a;
+	}
+	inline __m256i & operator += (__m256i & a, int b)
+	{
+		a = a + b;
+		return a;
+	}
+
+	inline __m256i & operator -= (__m256i & a, __m256i b)
+	{
+		a = a - b;
+		return a;
+	}
+	inline __m256i & operator -= (__m256i & a, int b)
+	{
+		a = a - b;
+		return a;
+	}
+
+	inline __m256i & operator *= (__m256i & a, __m256i b)
+	{
+		a = a * b;
+		return a;
+	}
+	inline __m256i & operator *= (__m256i & a, int b)
+	{
+		a = a * b;
+		return a;
+	}
+
+	// No 32-bit integer divide
+
+	inline __m256i & operator &= (__m256i & a, __m256i b)
+	{
+		a = a & b;
+		return a;
+	}
+	inline __m256i & operator &= (__m256i & a, int b)
+	{
+		a = a & b;
+		return a;
+	}
+
+	inline __m256i & operator |= (__m256i & a, __m256i b)
+	{
+		a = a | b;
+		return a;
+	}
+	inline __m256i & operator |= (__m256i & a, int b)
+	{
+		a = a | b;
+		return a;
+	}
+
+	inline __m256i & operator ^= (__m256i & a, __m256i b)
+	{
+		a = a ^ b;
+		return a;
+	}
+	inline __m256i & operator ^= (__m256i & a, int b)
+	{
+		a = a ^ b;
+		return a;
+	}
+
+	inline __m256i operator == (__m256i a, __m256i b)
+	{
+		return _mm256_cmpeq_epi32(a, b);
+	}
+	inline __m256i operator == (int a, __m256i b)
+	{
+		return _mm256_cmpeq_epi32(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator == (__m256i a, int b)
+	{
+		return _mm256_cmpeq_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	inline __m256i operator != (__m256i a, __m256i b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpeq_epi32(a, b), _mm256_set1_epi32(~0));
+	}
+	inline __m256i operator != (int a, __m256i b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_set1_epi32(a), b), _mm256_set1_epi32(~0));
+	}
+	inline __m256i operator != (__m256i a, int b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpeq_epi32(a, _mm256_set1_epi32(b)), _mm256_set1_epi32(~0));
+	}
+
+	inline __m256i operator < (__m256i a, __m256i b)
+	{
+		return _mm256_cmpgt_epi32(b, a);
+	}
+	inline __m256i operator < (int a, __m256i b)
+	{
+		return _mm256_cmpgt_epi32(b, _mm256_set1_epi32(a));
+	}
+	inline __m256i operator < (__m256i a, int b)
+	{
+		return _mm256_cmpgt_epi32(_mm256_set1_epi32(b), a);
+	}
+
+	inline __m256i operator > (__m256i a, __m256i b)
+	{
+		return _mm256_cmpgt_epi32(a, b);
+	}
+	inline __m256i operator > (int a, __m256i b)
+	{
+		return _mm256_cmpgt_epi32(_mm256_set1_epi32(a), b);
+	}
+	inline __m256i operator > (__m256i a, int b)
+	{
+		return _mm256_cmpgt_epi32(a, _mm256_set1_epi32(b));
+	}
+
+	inline __m256i operator <= (__m256i a, __m256i b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpgt_epi32(a, b), _mm256_set1_epi32(~0));
+	}
+	inline __m256i operator <= (int a, __m256i b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(a), b), _mm256_set1_epi32(~0));
+	}
+	inline __m256i operator <= (__m256i a, int b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpgt_epi32(a, _mm256_set1_epi32(b)), _mm256_set1_epi32(~0));
+	}
+
+	inline __m256i operator >= (__m256i a, __m256i b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpgt_epi32(b, a), _mm256_set1_epi32(~0));
+	}
+	inline __m256i operator >= (int a, __m256i b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpgt_epi32(b, _mm256_set1_epi32(a)), _mm256_set1_epi32(~0));
+	}
+	inline __m256i operator >= (__m256i a, int b)
+	{
+		return _mm256_andnot_si256(_mm256_cmpgt_epi32(_mm256_set1_epi32(b), a), _mm256_set1_epi32(~0));
+	}
+
+
+
+
+	// Overloaded operators for __m512 (AVX-512), so it can be used in vectors.
+	// Note: comparisons return a __mmask16 (one bit per lane) rather than an all-ones vector.
+
+	inline __m512 operator + (__m512 a, __m512 b)
+	{
+		return _mm512_add_ps(a, b);
+	}
+	inline __m512 operator + (float a, __m512 b)
+	{
+		return _mm512_add_ps(_mm512_set1_ps(a), b);
+	}
+	inline __m512 operator + (__m512 a, float b)
+	{
+		return _mm512_add_ps(a, _mm512_set1_ps(b));
+	}
+
+	inline __m512 operator - (__m512 a, __m512 b)
+	{
+		return _mm512_sub_ps(a, b);
+	}
+	inline __m512 operator - (float a, __m512 b)
+	{
+		return _mm512_sub_ps(_mm512_set1_ps(a), b);
+	}
+	inline __m512 operator - (__m512 a, float b)
+	{
+		return _mm512_sub_ps(a, _mm512_set1_ps(b));
+	}
+
+	inline __m512 operator - (__m512 a)
+	{
+		return _mm512_sub_ps(_mm512_setzero_ps(), a);
+	}
+
+	inline __m512 operator * (__m512 a, __m512 b)
+	{
+		return _mm512_mul_ps(a, b);
+	}
+	inline __m512 operator * (float a, __m512 b)
+	{
+		return _mm512_mul_ps(_mm512_set1_ps(a), b);
+	}
+	inline __m512 operator * (__m512 a, float b)
+	{
+		return _mm512_mul_ps(a, _mm512_set1_ps(b));
+	}
+
+	inline __m512 operator / (__m512 a, __m512 b)
+	{
+		return _mm512_div_ps(a, b);
+	}
+	inline __m512 operator / (float a, __m512 b)
+	{
+		return _mm512_div_ps(_mm512_set1_ps(a), b);
+	}
+	inline __m512 operator / (__m512 a, float b)
+	{
+		return _mm512_div_ps(a, _mm512_set1_ps(b));
+	}
+
+	inline __m512 operator & (__m512 a, __m512 b)
+	{
+		return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+	}
+	inline __m512 operator & (float a, __m512 b)
+	{
+		return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(_mm512_set1_ps(a)), _mm512_castps_si512(b)));
+	}
+	inline __m512 operator & (__m512 a, float b)
+	{
+		return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a), _mm512_castps_si512(_mm512_set1_ps(b))));
+	}
+
+	inline __m512 operator | (__m512 a, __m512 b)
+	{
+		return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+	}
+	inline __m512 operator | (float a, __m512 b)
+	{
+		return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(_mm512_set1_ps(a)), _mm512_castps_si512(b)));
+	}
+	inline __m512 operator | (__m512 a, float b)
+	{
+		return _mm512_castsi512_ps(_mm512_or_si512(_mm512_castps_si512(a), _mm512_castps_si512(_mm512_set1_ps(b))));
+	}
+
+	inline __m512 operator ^ (__m512 a, __m512 b)
+	{
+		return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(b)));
+	}
+	inline __m512 operator ^ (float a, __m512 b)
+	{
+		return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(_mm512_set1_ps(a)), _mm512_castps_si512(b)));
+	}
+	inline __m512 operator ^ (__m512 a, float b)
+	{
+		return _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a), _mm512_castps_si512(_mm512_set1_ps(b))));
+	}
+
+	inline __m512 operator ! (__m512 a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm512_castsi512_ps(_mm512_andnot_si512(_mm512_castps_si512(a), _mm512_set1_epi32(~0)));
+	}
+
+	inline __m512 operator ~ (__m512 a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm512_castsi512_ps(_mm512_andnot_si512(_mm512_castps_si512(a), _mm512_set1_epi32(~0)));
+	}
+
+	inline __m512 & operator += (__m512 & a, __m512 b)
+	{
+		a = a + b;
+		return a;
+	}
+	inline __m512 & operator += (__m512 & a, float b)
+	{
+		a = a + b;
+		return a;
+	}
+
+	inline __m512 & operator -= (__m512 & a, __m512 b)
+	{
+		a = a - b;
+		return a;
+	}
+	inline __m512 & operator -= (__m512 & a, float b)
+	{
+		a = a - b;
+		return a;
+	}
+
+	inline __m512 & operator *= (__m512 & a, __m512 b)
+	{
+		a = a * b;
+		return a;
+	}
+	inline __m512 & operator *= (__m512 & a, float b)
+	{
+		a = a * b;
+		return a;
+	}
+
+	inline __m512 & operator /= (__m512 & a, __m512 b)
+	{
+		a = a / b;
+		return a;
+	}
+	inline __m512 & operator /= (__m512 & a, float b)
+	{
+		a = a / b;
+		return a;
+	}
+
+	inline __m512 & operator &= (__m512 & a, __m512 b)
+	{
+		a = a & b;
+		return a;
+	}
+	inline __m512 & operator &= (__m512 & a, float b)
+	{
+		a = a & b;
+		return a;
+	}
+
+	inline __m512 & operator |= (__m512 & a, __m512 b)
+	{
+		a = a | b;
+		return a;
+	}
+	inline __m512 & operator |= (__m512 & a, float b)
+	{
+		a = a | b;
+		return a;
+	}
+
+	inline __m512 & operator ^= (__m512 & a, __m512 b)
+	{
+		a = a ^ b;
+		return a;
+	}
+	inline __m512 & operator ^= (__m512 & a, float b)
+	{
+		a = a ^ b;
+		return a;
+	}
+
+	inline __mmask16 operator == (__m512 a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(a, b, _CMP_EQ_OQ);
+	}
+	inline __mmask16 operator == (float a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(_mm512_set1_ps(a), b, _CMP_EQ_OQ);
+	}
+	inline __mmask16 operator == (__m512 a, float b)
+	{
+		return _mm512_cmp_ps_mask(a, _mm512_set1_ps(b), _CMP_EQ_OQ);
+	}
+
+	inline __mmask16 operator != (__m512 a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(a, b, _CMP_NEQ_UQ);
+	}
+	inline __mmask16 operator != (float a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(_mm512_set1_ps(a), b, _CMP_NEQ_UQ);
+	}
+	inline __mmask16 operator != (__m512 a, float b)
+	{
+		return _mm512_cmp_ps_mask(a, _mm512_set1_ps(b), _CMP_NEQ_UQ);
+	}
+
+	inline __mmask16 operator < (__m512 a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(a, b, _CMP_LT_OQ);
+	}
+	inline __mmask16 operator < (float a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(_mm512_set1_ps(a), b, _CMP_LT_OQ);
+	}
+	inline __mmask16 operator < (__m512 a, float b)
+	{
+		return _mm512_cmp_ps_mask(a, _mm512_set1_ps(b), _CMP_LT_OQ);
+	}
+
+	inline __mmask16 operator > (__m512 a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(a, b, _CMP_GT_OQ);
+	}
+	inline __mmask16 operator > (float a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(_mm512_set1_ps(a), b, _CMP_GT_OQ);
+	}
+	inline __mmask16 operator > (__m512 a, float b)
+	{
+		return _mm512_cmp_ps_mask(a, _mm512_set1_ps(b), _CMP_GT_OQ);
+	}
+
+	inline __mmask16 operator <= (__m512 a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(a, b, _CMP_LE_OQ);
+	}
+	inline __mmask16 operator <= (float a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(_mm512_set1_ps(a), b, _CMP_LE_OQ);
+	}
+	inline __mmask16 operator <= (__m512 a, float b)
+	{
+		return _mm512_cmp_ps_mask(a, _mm512_set1_ps(b), _CMP_LE_OQ);
+	}
+
+	inline __mmask16 operator >= (__m512 a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ);
+	}
+	inline __mmask16 operator >= (float a, __m512 b)
+	{
+		return _mm512_cmp_ps_mask(_mm512_set1_ps(a), b, _CMP_GE_OQ);
+	}
+	inline __mmask16 operator >= (__m512 a, float b)
+	{
+		return _mm512_cmp_ps_mask(a, _mm512_set1_ps(b), _CMP_GE_OQ);
+	}
+
+
+
+	// Overloaded operators for __m512i (AVX-512), so it can be used in vectors.
+	// Note: comparisons return a __mmask16 (one bit per lane) rather than an all-ones vector.
+
+	inline __m512i operator + (__m512i a, __m512i b)
+	{
+		return _mm512_add_epi32(a, b);
+	}
+	inline __m512i operator + (int a, __m512i b)
+	{
+		return _mm512_add_epi32(_mm512_set1_epi32(a), b);
+	}
+	inline __m512i operator + (__m512i a, int b)
+	{
+		return _mm512_add_epi32(a, _mm512_set1_epi32(b));
+	}
+
+	inline __m512i operator - (__m512i a, __m512i b)
+	{
+		return _mm512_sub_epi32(a, b);
+	}
+	inline __m512i operator - (int a, __m512i b)
+	{
+		return _mm512_sub_epi32(_mm512_set1_epi32(a), b);
+	}
+	inline __m512i operator - (__m512i a, int b)
+	{
+		return _mm512_sub_epi32(a, _mm512_set1_epi32(b));
+	}
+
+	inline __m512i operator - (__m512i a)
+	{
+		return _mm512_sub_epi32(_mm512_setzero_si512(), a);
+	}
+
+	inline __m512i operator * (__m512i a, __m512i b)
+	{
+		return _mm512_mullo_epi32(a, b);
+	}
+	inline __m512i operator * (int a, __m512i b)
+	{
+		return _mm512_mullo_epi32(_mm512_set1_epi32(a), b);
+	}
+	inline __m512i operator * (__m512i a, int b)
+	{
+		return _mm512_mullo_epi32(a, _mm512_set1_epi32(b));
+	}
+
+	// Note: there's no 32-bit integer divide in AVX-512 either.
+
+	inline __m512i operator & (__m512i a, __m512i b)
+	{
+		return _mm512_and_si512(a, b);
+	}
+	inline __m512i operator & (int a, __m512i b)
+	{
+		return _mm512_and_si512(_mm512_set1_epi32(a), b);
+	}
+	inline __m512i operator & (__m512i a, int b)
+	{
+		return _mm512_and_si512(a, _mm512_set1_epi32(b));
+	}
+
+	inline __m512i operator | (__m512i a, __m512i b)
+	{
+		return _mm512_or_si512(a, b);
+	}
+	inline __m512i operator | (int a, __m512i b)
+	{
+		return _mm512_or_si512(_mm512_set1_epi32(a), b);
+	}
+	inline __m512i operator | (__m512i a, int b)
+	{
+		return _mm512_or_si512(a, _mm512_set1_epi32(b));
+	}
+
+	inline __m512i operator ^ (__m512i a, __m512i b)
+	{
+		return _mm512_xor_si512(a, b);
+	}
+	inline __m512i operator ^ (int a, __m512i b)
+	{
+		return _mm512_xor_si512(_mm512_set1_epi32(a), b);
+	}
+	inline __m512i operator ^ (__m512i a, int b)
+	{
+		return _mm512_xor_si512(a, _mm512_set1_epi32(b));
+	}
+
+	inline __m512i operator ! (__m512i a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm512_andnot_si512(a, _mm512_set1_epi32(~0));
+	}
+
+	inline __m512i operator ~ (__m512i a)
+	{
+		// Note: there's no bitwise-not, so we have to use "andnot" (= ~a & b) with b = true.
+		return _mm512_andnot_si512(a, _mm512_set1_epi32(~0));
+	}
+
+	inline __m512i & operator += (__m512i & a, __m512i b)
+	{
+		a = a + b;
+		return a;
+	}
+	inline __m512i & operator += (__m512i & a, int b)
+	{
+		a = a + b;
+		return a;
+	}
+
+	inline __m512i & operator -= (__m512i & a, __m512i b)
+	{
+		a = a - b;
+		return a;
+	}
+	inline __m512i & operator -= (__m512i & a, int b)
+	{
+		a = a - b;
+		return a;
+	}
+
+	inline __m512i & operator *= (__m512i & a, __m512i b)
+	{
+		a = a * b;
+		return a;
+	}
+	inline __m512i & operator *= (__m512i & a, int b)
+	{
+		a = a * b;
+		return a;
+	}
+
+	// No 32-bit integer divide
+
+	inline __m512i & operator &= (__m512i & a, __m512i b)
+	{
+		a = a & b;
+		return a;
+	}
+	inline __m512i & operator &= (__m512i & a, int b)
+	{
+		a = a & b;
+		return a;
+	}
+
+	inline __m512i & operator |= (__m512i & a, __m512i b)
+	{
+		a = a | b;
+		return a;
+	}
+	inline __m512i & operator |= (__m512i & a, int b)
+	{
+		a = a | b;
+		return a;
+	}
+
+	inline __m512i & operator ^= (__m512i & a, __m512i b)
+	{
+		a = a ^ b;
+		return a;
+	}
+	inline __m512i & operator ^= (__m512i & a, int b)
+	{
+		a = a ^ b;
+		return a;
+	}
+
+	inline __mmask16 operator == (__m512i a, __m512i b)
+	{
+		return _mm512_cmpeq_epi32_mask(a, b);
+	}
+	inline __mmask16 operator == (int a, __m512i b)
+	{
+		return _mm512_cmpeq_epi32_mask(_mm512_set1_epi32(a), b);
+	}
+	inline __mmask16 operator == (__m512i a, int b)
+	{
+		return _mm512_cmpeq_epi32_mask(a, _mm512_set1_epi32(b));
+	}
+
+	inline __mmask16 operator != (__m512i a, __m512i b)
+	{
+		return _mm512_cmpneq_epi32_mask(a, b);
+	}
+	inline __mmask16 operator != (int a, __m512i b)
+	{
+		return _mm512_cmpneq_epi32_mask(_mm512_set1_epi32(a), b);
+	}
+	inline __mmask16 operator != (__m512i a, int b)
+	{
+		return _mm512_cmpneq_epi32_mask(a, _mm512_set1_epi32(b));
+	}
+
+	inline __mmask16 operator < (__m512i a, __m512i b)
+	{
+		return _mm512_cmplt_epi32_mask(a, b);
+	}
+	inline __mmask16 operator < (int a, __m512i b)
+	{
+		return _mm512_cmplt_epi32_mask(_mm512_set1_epi32(a), b);
+	}
+	inline __mmask16 operator < (__m512i a, int b)
+	{
+		return _mm512_cmplt_epi32_mask(a, _mm512_set1_epi32(b));
+	}
+
+	inline __mmask16 operator > (__m512i a, __m512i b)
+	{
+		return _mm512_cmpgt_epi32_mask(a, b);
+	}
+	inline __mmask16 operator > (int a, __m512i b)
+	{
+		return _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(a), b);
+	}
+	inline __mmask16 operator > (__m512i a, int b)
+	{
+		return _mm512_cmpgt_epi32_mask(a, _mm512_set1_epi32(b));
+	}
+
+	inline __mmask16 operator <= (__m512i a, __m512i b)
+	{
+		return _mm512_cmple_epi32_mask(a, b);
+	}
+	inline __mmask16 operator <= (int a, __m512i b)
+	{
+		return _mm512_cmple_epi32_mask(_mm512_set1_epi32(a), b);
+	}
+	inline __mmask16 operator <= (__m512i a, int b)
+	{
+		return _mm512_cmple_epi32_mask(a, _mm512_set1_epi32(b));
+	}
+
+	inline __mmask16 operator >= (__m512i a, __m512i b)
+	{
+		return _mm512_cmpge_epi32_mask(a, b);
+	}
+	inline __mmask16 operator >= (int a, __m512i b)
+	{
+		return _mm512_cmpge_epi32_mask(_mm512_set1_epi32(a), b);
+	}
+	inline __mmask16 operator >= (__m512i a, int b)
+	{
+		return _mm512_cmpge_epi32_mask(a, _mm512_set1_epi32(b));
+	}
+
+
+
+	// Mask utilities for AVX-512 lane types.  Since comparisons produce a __mmask16,
+	// select maps directly onto a masked blend, and any/all are just tests of the mask bits.
+
+	inline __m512 select(__mmask16 cond, __m512 a, __m512 b)
+	{
+		return _mm512_mask_blend_ps(cond, b, a);
+	}
+	inline __m512 select(__mmask16 cond, float a, __m512 b)
+	{
+		return _mm512_mask_blend_ps(cond, b, _mm512_set1_ps(a));
+	}
+	inline __m512 select(__mmask16 cond, __m512 a, float b)
+	{
+		return _mm512_mask_blend_ps(cond, _mm512_set1_ps(b), a);
+	}
+
+	inline __m512i select(__mmask16 cond, __m512i a, __m512i b)
+	{
+		return _mm512_mask_blend_epi32(cond, b, a);
+	}
+	inline __m512i select(__mmask16 cond, int a, __m512i b)
+	{
+		return _mm512_mask_blend_epi32(cond, b, _mm512_set1_epi32(a));
+	}
+	inline __m512i select(__mmask16 cond, __m512i a, int b)
+	{
+		return _mm512_mask_blend_epi32(cond, _mm512_set1_epi32(b), a);
+	}
+
+	inline bool any(__mmask16 a)
+		{ return (a != 0); }
+	inline bool all(__mmask16 a)
+		{ return (a == 0xffff); }
+
+	// Min/max need overloads, since the generic ones would convert the mask to a single bool
+	inline __m512 min(__m512 a, __m512 b)
+		{ return _mm512_min_ps(a, b); }
+	inline __m512 max(__m512 a, __m512 b)
+		{ return _mm512_max_ps(a, b); }
+	inline __m512i min(__m512i a, __m512i b)
+		{ return _mm512_min_epi32(a, b); }
+	inline __m512i max(__m512i a, __m512i b)
+		{ return _mm512_max_epi32(a, b); }
+
+
+
+	
+	// Lane utilities for the SSE and AVX types.  Comparisons produce a mask with all bits set
+	// or clear in each lane, so select is a bitwise blend.  Integer masks can also select
+	// between float lanes, which comes up when working with the bits of floats.
+
+	inline __m128 select(__m128 cond, __m128 a, __m128 b)
+	{
+#if ENABLE_SSE41
+		return _mm_blendv_ps(b, a, cond);
+#else
+		return _mm_or_ps(_mm_and_ps(cond, a), _mm_andnot_ps(cond, b));
+#endif
+	}
+	inline __m128 select(__m128 cond, float a, __m128 b)
+	{
+		return select(cond, _mm_set1_ps(a), b);
+	}
+	inline __m128 select(__m128 cond, __m128 a, float b)
+	{
+		return select(cond, a, _mm_set1_ps(b));
+	}
+	inline __m128 select(__m128i cond, __m128 a, __m128 b)
+	{
+		return select(_mm_castsi128_ps(cond), a, b);
+	}
+
+	inline __m128i select(__m128i cond, __m128i a, __m128i b)
+	{
+#if ENABLE_SSE41
+		return _mm_blendv_epi8(b, a, cond);
+#else
+		return _mm_or_si128(_mm_and_si128(cond, a), _mm_andnot_si128(cond, b));
+#endif
+	}
+	inline __m128i select(__m128i cond, int a, __m128i b)
+	{
+		return select(cond, _mm_set1_epi32(a), b);
+	}
+	inline __m128i select(__m128i cond, __m128i a, int b)
+	{
+		return select(cond, a, _mm_set1_epi32(b));
+	}
+
+	inline __m256 select(__m256 cond, __m256 a, __m256 b)
+	{
+		return _mm256_blendv_ps(b, a, cond);
+	}
+	inline __m256 select(__m256 cond, float a, __m256 b)
+	{
+		return _mm256_blendv_ps(b, _mm256_set1_ps(a), cond);
+	}
+	inline __m256 select(__m256 cond, __m256 a, float b)
+	{
+		return _mm256_blendv_ps(_mm256_set1_ps(b), a, cond);
+	}
+	inline __m256 select(__m256i cond, __m256 a, __m256 b)
+	{
+		return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(cond));
+	}
+
+	inline __m256i select(__m256i cond, __m256i a, __m256i b)
+	{
+		return _mm256_blendv_epi8(b, a, cond);
+	}
+	inline __m256i select(__m256i cond, int a, __m256i b)
+	{
+		return _mm256_blendv_epi8(b, _mm256_set1_epi32(a), cond);
+	}
+	inline __m256i select(__m256i cond, __m256i a, int b)
+	{
+		return _mm256_blendv_epi8(_mm256_set1_epi32(b), a, cond);
+	}
+
+	// Any/all reduce a comparison mask to a single bool, e.g. for early-outs:
+	//   if (!any(any(abs(p) > extent))) ...
+	// (the inner any reduces the vector components, per-lane; the outer one reduces the lanes).
+	// Only the sign bit of each lane is tested, which is all bits for a comparison result.
+	inline bool any(__m128 a)
+		{ return (_mm_movemask_ps(a) != 0); }
+	inline bool all(__m128 a)
+		{ return (_mm_movemask_ps(a) == 0xf); }
+	inline bool any(__m128i a)
+		{ return (_mm_movemask_ps(_mm_castsi128_ps(a)) != 0); }
+	inline bool all(__m128i a)
+		{ return (_mm_movemask_ps(_mm_castsi128_ps(a)) == 0xf); }
+	inline bool any(__m256 a)
+		{ return (_mm256_movemask_ps(a) != 0); }
+	inline bool all(__m256 a)
+		{ return (_mm256_movemask_ps(a) == 0xff); }
+	inline bool any(__m256i a)
+		{ return (_mm256_movemask_ps(_mm256_castsi256_ps(a)) != 0); }
+	inline bool all(__m256i a)
+		{ return (_mm256_movemask_ps(_mm256_castsi256_ps(a)) == 0xff); }
+
+	// Compact lane mask: one bit per lane, taken from the lane's sign bit.  Useful when the
+	// mask is kept around, e.g. to count the active lanes or loop over them.  For AVX-512,
+	// this is just the __mmask16 from a comparison.
+	typedef uint lanemask;
+
+	inline lanemask movemask(__m128 a)
+		{ return lanemask(_mm_movemask_ps(a)); }
+	inline lanemask movemask(__m128i a)
+		{ return lanemask(_mm_movemask_ps(_mm_castsi128_ps(a))); }
+	inline lanemask movemask(__m256 a)
+		{ return lanemask(_mm256_movemask_ps(a)); }
+	inline lanemask movemask(__m256i a)
+		{ return lanemask(_mm256_movemask_ps(_mm256_castsi256_ps(a))); }
+	inline lanemask movemask(__mmask16 a)
+		{ return lanemask(a); }
+
+	// As with the AVX-512 versions, min/max need overloads.  Note that like the underlying
+	// instructions, they return the second argument if either one is NaN.
+	inline __m128 min(__m128 a, __m128 b)
+		{ return _mm_min_ps(a, b); }
+	inline __m128 max(__m128 a, __m128 b)
+		{ return _mm_max_ps(a, b); }
+#if ENABLE_SSE41
+	inline __m128i min(__m128i a, __m128i b)
+		{ return _mm_min_epi32(a, b); }
+	inline __m128i max(__m128i a, __m128i b)
+		{ return _mm_max_epi32(a, b); }
+#else
+	inline __m128i min(__m128i a, __m128i b)
+		{ return select(a < b, a, b); }
+	inline __m128i max(__m128i a, __m128i b)
+		{ return select(a < b, b, a); }
+#endif
+	inline __m256 min(__m256 a, __m256 b)
+		{ return _mm256_min_ps(a, b); }
+	inline __m256 max(__m256 a, __m256 b)
+		{ return _mm256_max_ps(a, b); }
+	inline __m256i min(__m256i a, __m256i b)
+		{ return _mm256_min_epi32(a, b); }
+	inline __m256i max(__m256i a, __m256i b)
+		{ return _mm256_max_epi32(a, b); }
+
+	inline __m128 abs(__m128 a)
+		{ return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	inline __m128i abs(__m128i a)
+		{ __m128i sign = _mm_srai_epi32(a, 31); return _mm_sub_epi32(_mm_xor_si128(a, sign), sign); }
+	inline __m256 abs(__m256 a)
+		{ return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	inline __m256i abs(__m256i a)
+		{ return _mm256_abs_epi32(a); }
+	inline __m512 abs(__m512 a)
+		{ return _mm512_abs_ps(a); }
+	inline __m512i abs(__m512i a)
+		{ return _mm512_abs_epi32(a); }
+
+	// Fused multiply-add, a*b + c.  The SSE and AVX ones are only fused when ENABLE_FMA is on;
+	// AVX-512 always has FMA.  (The dispatched kernels in
+	// util-simd.cpp don't depend on it; see kernelFma there.)
+#if ENABLE_FMA
+	inline __m128 fma(__m128 a, __m128 b, __m128 c)
+		{ return _mm_fmadd_ps(a, b, c); }
+	inline __m256 fma(__m256 a, __m256 b, __m256 c)
+		{ return _mm256_fmadd_ps(a, b, c); }
+#else
+	inline __m128 fma(__m128 a, __m128 b, __m128 c)
+		{ return _mm_add_ps(_mm_mul_ps(a, b), c); }
+	inline __m256 fma(__m256 a, __m256 b, __m256 c)
+		{ return _mm256_add_ps(_mm256_mul_ps(a, b), c); }
+#endif
+	inline __m512 fma(__m512 a, __m512 b, __m512 c)
+		{ return _mm512_fmadd_ps(a, b, c); }
+
+	// Dot products of vectors of float lanes accumulate with fma.  (The generic dot is a plain
+	// multiply-add, so it can be constexpr.)
+	template <int n>
+	__m128 dot(vector<__m128, n> a, vector<__m128, n> b)
+	{
+		__m128 result = a[0] * b[0];
+		for (int i = 1; i < n; ++i)
+			result = fma(a[i], b[i], result);
+		return result;
+	}
+	template <int n>
+	__m256 dot(vector<__m256, n> a, vector<__m256, n> b)
+	{
+		__m256 result = a[0] * b[0];
+		for (int i = 1; i < n; ++i)
+			result = fma(a[i], b[i], result);
+		return result;
+	}
+	template <int n>
+	__m512 dot(vector<__m512, n> a, vector<__m512, n> b)
+	{
+		__m512 result = a[0] * b[0];
+		for (int i = 1; i < n; ++i)
+			result = fma(a[i], b[i], result);
+		return result;
+	}
+
+	// Horizontal reductions: combine all the lanes into a single scalar.  These are relatively
+	// slow (a chain of shuffles), so they're best kept out of inner loops - e.g. accumulate a
+	// sum in lanes, then reduce it once at the end.
+	inline float horizontalSum(__m128 a)
+	{
+		__m128 t = _mm_add_ps(a, _mm_movehl_ps(a, a));
+		return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+	inline float horizontalMin(__m128 a)
+	{
+		__m128 t = _mm_min_ps(a, _mm_movehl_ps(a, a));
+		return _mm_cvtss_f32(_mm_min_ss(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+	inline float horizontalMax(__m128 a)
+	{
+		__m128 t = _mm_max_ps(a, _mm_movehl_ps(a, a));
+		return _mm_cvtss_f32(_mm_max_ss(t, _mm_shuffle_ps(t, t, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+	inline int horizontalSum(__m128i a)
+	{
+		__m128i t = _mm_add_epi32(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtsi128_si32(_mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+	inline int horizontalMin(__m128i a)
+	{
+		__m128i t = min(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtsi128_si32(min(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+	inline int horizontalMax(__m128i a)
+	{
+		__m128i t = max(a, _mm_shuffle_epi32(a, _MM_SHUFFLE(1, 0, 3, 2)));
+		return _mm_cvtsi128_si32(max(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1))));
+	}
+	inline float horizontalSum(__m256 a)
+		{ return horizontalSum(_mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1))); }
+	inline float horizontalMin(__m256 a)
+		{ return horizontalMin(_mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1))); }
+	inline float horizontalMax(__m256 a)
+		{ return horizontalMax(_mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1))); }
+	inline int horizontalSum(__m256i a)
+		{ return horizontalSum(_mm_add_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1))); }
+	inline int horizontalMin(__m256i a)
+		{ return horizontalMin(_mm_min_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1))); }
+	inline int horizontalMax(__m256i a)
+		{ return horizontalMax(_mm_max_epi32(_mm256_castsi256_si128(a), _mm256_extracti128_si256(a, 1))); }
+	inline float horizontalSum(__m512 a)
+		{ return _mm512_reduce_add_ps(a); }
+	inline float horizontalMin(__m512 a)
+		{ return _mm512_reduce_min_ps(a); }
+	inline float horizontalMax(__m512 a)
+		{ return _mm512_reduce_max_ps(a); }
+	inline int horizontalSum(__m512i a)
+		{ return _mm512_reduce_add_epi32(a); }
+	inline int horizontalMin(__m512i a)
+		{ return _mm512_reduce_min_epi32(a); }
+	inline int horizontalMax(__m512i a)
+		{ return _mm512_reduce_max_epi32(a); }
+
+	// Horizontal reductions of a vector of lanes, per component; e.g. the bounding box of the
+	// points in a float3_simd is { horizontalMin(p), horizontalMax(p) }
+	template <typename T, int n>
+	auto horizontalSum(vector<T, n> const & a) -> vector<decltype(horizontalSum(a[0])), n>
+	{
+		vector<decltype(horizontalSum(a[0])), n> result;
+		for (int i = 0; i < n; ++i)
+			result[i] = horizontalSum(a[i]);
+		return result;
+	}
+	template <typename T, int n>
+	auto horizontalMin(vector<T, n> const & a) -> vector<decltype(horizontalMin(a[0])), n>
+	{
+		vector<decltype(horizontalMin(a[0])), n> result;
+		for (int i = 0; i < n; ++i)
+			result[i] = horizontalMin(a[i]);
+		return result;
+	}
+	template <typename T, int n>
+	auto horizontalMax(vector<T, n> const & a) -> vector<decltype(horizontalMax(a[0])), n>
+	{
+		vector<decltype(horizontalMax(a[0])), n> result;
+		for (int i = 0; i < n; ++i)
+			result[i] = horizontalMax(a[i]);
+		return result;
+	}
+
+	// Shifts of each 32-bit lane.  Right shifts are arithmetic, since the lanes are signed ints.
+	inline __m128i operator << (__m128i a, int b)
+		{ return _mm_sll_epi32(a, _mm_cvtsi32_si128(b)); }
+	inline __m128i operator >> (__m128i a, int b)
+		{ return _mm_sra_epi32(a, _mm_cvtsi32_si128(b)); }
+	inline __m256i operator << (__m256i a, int b)
+		{ return _mm256_sll_epi32(a, _mm_cvtsi32_si128(b)); }
+	inline __m256i operator >> (__m256i a, int b)
+		{ return _mm256_sra_epi32(a, _mm_cvtsi32_si128(b)); }
+	inline __m512i operator << (__m512i a, int b)
+		{ return _mm512_sll_epi32(a, _mm_cvtsi32_si128(b)); }
+	inline __m512i operator >> (__m512i a, int b)
+		{ return _mm512_sra_epi32(a, _mm_cvtsi32_si128(b)); }
+
+	// Conversions between float and int lanes: reinterpreting the bits, rounding to nearest
+	// (in the default rounding mode), truncating, and converting int to float.
+	inline __m128i bitsAsInt(__m128 a)
+		{ return _mm_castps_si128(a); }
+	inline __m128 bitsAsFloat(__m128i a)
+		{ return _mm_castsi128_ps(a); }
+	inline __m128i roundToInt(__m128 a)
+		{ return _mm_cvtps_epi32(a); }
+	inline __m128i truncToInt(__m128 a)
+		{ return _mm_cvttps_epi32(a); }
+	inline __m128 toFloat(__m128i a)
+		{ return _mm_cvtepi32_ps(a); }
+	inline __m256i bitsAsInt(__m256 a)
+		{ return _mm256_castps_si256(a); }
+	inline __m256 bitsAsFloat(__m256i a)
+		{ return _mm256_castsi256_ps(a); }
+	inline __m256i roundToInt(__m256 a)
+		{ return _mm256_cvtps_epi32(a); }
+	inline __m256i truncToInt(__m256 a)
+		{ return _mm256_cvttps_epi32(a); }
+	inline __m256 toFloat(__m256i a)
+		{ return _mm256_cvtepi32_ps(a); }
+	inline __m512i bitsAsInt(__m512 a)
+		{ return _mm512_castps_si512(a); }
+	inline __m512 bitsAsFloat(__m512i a)
+		{ return _mm512_castsi512_ps(a); }
+	inline __m512i roundToInt(__m512 a)
+		{ return _mm512_cvtps_epi32(a); }
+	inline __m512i truncToInt(__m512 a)
+		{ return _mm512_cvttps_epi32(a); }
+	inline __m512 toFloat(__m512i a)
+		{ return _mm512_cvtepi32_ps(a); }
+
+	// Broadcast a float to all lanes, e.g. splat<__m128>(1.0f)
+	template <>
+	inline __m128 splat<__m128>(float a)
+		{ return _mm_set1_ps(a); }
+	template <>
+	inline __m256 splat<__m256>(float a)
+		{ return _mm256_set1_ps(a); }
+	template <>
+	inline __m512 splat<__m512>(float a)
+		{ return _mm512_set1_ps(a); }
+
+	// Partial loads and stores: access only the first count lanes' worth of floats in memory,
+	// e.g. loadPartial<__m256>(p, 5).  Lanes past count are zero when loading, and the memory
+	// past count isn't touched (so it needn't be allocated).  count is in [0, lane width].
+	// These use masked loads/stores where available (AVX and AVX-512), or else SSE2 moves.
+	template <typename T>
+	T loadPartial(const float * p, int count);
+
+	template <>
+	inline __m128 loadPartial<__m128>(const float * p, int count)
+	{
+#if defined(__AVX__)
+		return _mm_maskload_ps(p, _mm_cmpgt_epi32(_mm_set1_epi32(count), _mm_setr_epi32(0, 1, 2, 3)));
+#else
+		switch (count)
+		{
+		case 0: return _mm_setzero_ps();
+		case 1: return _mm_load_ss(p);
+		case 2: return _mm_castpd_ps(_mm_load_sd((const double *)p));
+		case 3: return _mm_movelh_ps(_mm_castpd_ps(_mm_load_sd((const double *)p)), _mm_load_ss(p + 2));
+		default: return _mm_loadu_ps(p);
+		}
+#endif
+	}
+	template <>
+	inline __m256 loadPartial<__m256>(const float * p, int count)
+	{
+		return _mm256_maskload_ps(p, _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+	}
+	template <>
+	inline __m512 loadPartial<__m512>(const float * p, int count)
+	{
+		return _mm512_maskz_loadu_ps(__mmask16((1u << count) - 1), p);
+	}
+
+	inline void storePartial(float * p, __m128 a, int count)
+	{
+#if defined(__AVX__)
+		_mm_maskstore_ps(p, _mm_cmpgt_epi32(_mm_set1_epi32(count), _mm_setr_epi32(0, 1, 2, 3)), a);
+#else
+		switch (count)
+		{
+		case 0:
+			break;
+		case 1:
+			_mm_store_ss(p, a);
+			break;
+		case 2:
+			_mm_store_sd((double *)p, _mm_castps_pd(a));
+			break;
+		case 3:
+			_mm_store_sd((double *)p, _mm_castps_pd(a));
+			_mm_store_ss(p + 2, _mm_movehl_ps(a, a));
+			break;
+		default:
+			_mm_storeu_ps(p, a);
+			break;
+		}
+#endif
+	}
+	inline void storePartial(float * p, __m256 a, int count)
+	{
+		_mm256_maskstore_ps(p, _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)), a);
+	}
+	inline void storePartial(float * p, __m512 a, int count)
+	{
+		_mm512_mask_storeu_ps(p, __mmask16((1u << count) - 1), a);
+	}
+
+	// Partial loads and stores of a whole AOSOA chunk, such as a float3_simd: only the first
+	// count vectors in the chunk are accessed.  The chunk's components are assumed to be
+	// tightly packed, i.e. the stride between them is one lane.
+	template <typename T, int n>
+	void loadPartial(const float * pChunk, int count, vector<T, n> * pChunkOut)
+	{
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = loadPartial<T>(pChunk + j * (sizeof(T) / sizeof(float)), count);
+	}
+	template <typename T, int n>
+	void storePartial(float * pChunk, vector<T, n> const & chunk, int count)
+	{
+		for (int j = 0; j < n; ++j)
+			storePartial(pChunk + j * (sizeof(T) / sizeof(float)), chunk[j], count);
+	}
+
+	// Gather a chunk from AOS vectors through an index buffer: vector i of the chunk is
+	// pVectors[pIndices[i]].  This uses hardware gathers for AVX2 and above; otherwise it's
+	// a series of scalar loads, so it helps to call prefetchGather() for a chunk or two ahead.
+	// The partial versions only use the first count indices, and set the other lanes to zero.
+	template <int n>
+	void gather(const vector<float, n> * pVectors, const int * pIndices, vector<__m128, n> * pChunkOut)
+	{
+#if defined(__AVX2__)
+		__m128i offsets = _mm_loadu_si128((const __m128i *)pIndices) * n;
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm_i32gather_ps(&pVectors[0][j], offsets, sizeof(float));
+#else
+		const float * p0 = &pVectors[pIndices[0]][0];
+		const float * p1 = &pVectors[pIndices[1]][0];
+		const float * p2 = &pVectors[pIndices[2]][0];
+		const float * p3 = &pVectors[pIndices[3]][0];
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm_setr_ps(p0[j], p1[j], p2[j], p3[j]);
+#endif
+	}
+	template <int n>
+	void gather(const vector<float, n> * pVectors, const int * pIndices, vector<__m256, n> * pChunkOut)
+	{
+		__m256i offsets = _mm256_loadu_si256((const __m256i *)pIndices) * n;
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm256_i32gather_ps(&pVectors[0][j], offsets, sizeof(float));
+	}
+	template <int n>
+	void gather(const vector<float, n> * pVectors, const int * pIndices, vector<__m512, n> * pChunkOut)
+	{
+		__m512i offsets = _mm512_loadu_si512(pIndices) * n;
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm512_i32gather_ps(offsets, &pVectors[0][j], sizeof(float));
+	}
+
+	template <int n>
+	void gatherPartial(const vector<float, n> * pVectors, const int * pIndices, int count, vector<__m128, n> * pChunkOut)
+	{
+#if defined(__AVX2__)
+		__m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32(count), _mm_setr_epi32(0, 1, 2, 3));
+		__m128i offsets = _mm_maskload_epi32(pIndices, mask) * n;
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm_mask_i32gather_ps(_mm_setzero_ps(), &pVectors[0][j], offsets, _mm_castsi128_ps(mask), sizeof(float));
+#else
+		// Missing lanes read from a zero vector instead
+		const float zero[n] = {};
+		const float * p0 = (count > 0) ? &pVectors[pIndices[0]][0] : zero;
+		const float * p1 = (count > 1) ? &pVectors[pIndices[1]][0] : zero;
+		const float * p2 = (count > 2) ? &pVectors[pIndices[2]][0] : zero;
+		const float * p3 = (count > 3) ? &pVectors[pIndices[3]][0] : zero;
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm_setr_ps(p0[j], p1[j], p2[j], p3[j]);
+#endif
+	}
+	template <int n>
+	void gatherPartial(const vector<float, n> * pVectors, const int * pIndices, int count, vector<__m256, n> * pChunkOut)
+	{
+		__m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(count), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+		__m256i offsets = _mm256_maskload_epi32(pIndices, mask) * n;
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm256_mask_i32gather_ps(_mm256_setzero_ps(), &pVectors[0][j], offsets, _mm256_castsi256_ps(mask), sizeof(float));
+	}
+	template <int n>
+	void gatherPartial(const vector<float, n> * pVectors, const int * pIndices, int count, vector<__m512, n> * pChunkOut)
+	{
+		__mmask16 mask = __mmask16((1u << count) - 1);
+		__m512i offsets = _mm512_maskz_loadu_epi32(mask, pIndices) * n;
+		for (int j = 0; j < n; ++j)
+			(*pChunkOut)[j] = _mm512_mask_i32gather_ps(_mm512_setzero_ps(), mask, offsets, &pVectors[0][j], sizeof(float));
+	}
+
+	// Scatter a chunk to AOS vectors through an index buffer: pVectorsOut[pIndices[i]] is
+	// set to vector i of the chunk.  If an index is repeated, the highest lane wins.  This
+	// uses hardware scatters for AVX-512; otherwise it's a series of scalar stores.
+	template <typename T, int n>
+	void scatterPartial(vector<T, n> const & chunk, const int * pIndices, int count, vector<float, n> * pVectorsOut)
+	{
+		// The chunk is already in AOSOA order in memory, so just read the lanes out of it
+		const int W = sizeof(T) / sizeof(float);
+		const float * pChunk = (const float *)&chunk;
+		for (int i = 0; i < count; ++i)
+		{
+			for (int j = 0; j < n; ++j)
+				pVectorsOut[pIndices[i]][j] = pChunk[W*j + i];
+		}
+	}
+	template <int n>
+	void scatterPartial(vector<__m512, n> const & chunk, const int * pIndices, int count, vector<float, n> * pVectorsOut)
+	{
+		__mmask16 mask = __mmask16((1u << count) - 1);
+		__m512i offsets = _mm512_maskz_loadu_epi32(mask, pIndices) * n;
+		for (int j = 0; j < n; ++j)
+			_mm512_mask_i32scatter_ps(&pVectorsOut[0][j], mask, offsets, chunk[j], sizeof(float));
+	}
+	template <typename T, int n>
+	void scatter(vector<T, n> const & chunk, const int * pIndices, vector<float, n> * pVectorsOut)
+	{
+		scatterPartial(chunk, pIndices, sizeof(T) / sizeof(float), pVectorsOut);
+	}
+
+	// Prefetch the vectors for a gather, e.g. for the chunk after next
+	template <int n>
+	void prefetchGather(const vector<float, n> * pVectors, const int * pIndices, int count)
+	{
+		for (int i = 0; i < count; ++i)
+			_mm_prefetch((const char *)&pVectors[pIndices[i]], _MM_HINT_T0);
+	}
+
+
+
+	// Division by a runtime-invariant integer.  There's no SIMD integer divide, but dividing
+	// by a known value can be done with a multiply-high by a precomputed magic number and some
+	// shifts (Hacker's Delight, chapter 10).  Rounds toward zero like the built-in division.
+	// Construct the divisor once, outside the loop, e.g.:
+	//   divisor cellSize(17);
+	//   int3_simd cell = pos / cellSize;
+	//   int4_simd bucket = hash % cellSize;
+
+	struct divisor
+	{
+		int		value;
+		int		multiplier;		// Magic number
+		int		shift;
+		int		addMask;		// ~0 if the dividend is added to (or subtracted from) the product
+		int		negMask;		// ~0 if it's subtracted, for negative divisors
+		int		roundMask;		// ~0 if the quotient needs rounding toward zero at the end
+
+		divisor() {}
+		explicit divisor(int value);
+	};
+
+	namespace impl
+	{
+		// High 32 bits of the signed 64-bit product of each lane with m
+		inline int mulhi(int a, int m)
+			{ return int((i64(a) * m) >> 32); }
+		inline __m128i mulhi(__m128i a, int m)
+		{
+			__m128i mm = _mm_set1_epi32(m);
+#if ENABLE_SSE41
+			__m128i even = _mm_mul_epi32(a, mm);
+			__m128i odd = _mm_mul_epi32(_mm_srli_epi64(a, 32), mm);
+			return _mm_blend_epi16(_mm_srli_epi64(even, 32), odd, 0xcc);
+#else
+			// Unsigned multiply, then correct for the signs of the operands
+			__m128i even = _mm_mul_epu32(a, mm);
+			__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), mm);
+			__m128i result = _mm_or_si128(
+								_mm_srli_epi64(even, 32),
+								_mm_and_si128(odd, _mm_set_epi32(~0, 0, ~0, 0)));
+			return result - ((a >> 31) & m) - (a & (m >> 31));
+#endif
+		}
+		inline __m256i mulhi(__m256i a, int m)
+		{
+			__m256i mm = _mm256_set1_epi32(m);
+			__m256i even = _mm256_mul_epi32(a, mm);
+			__m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(a, 32), mm);
+			return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xaa);
+		}
+		inline __m512i mulhi(__m512i a, int m)
+		{
+			__m512i mm = _mm512_set1_epi32(m);
+			__m512i even = _mm512_mul_epi32(a, mm);
+			__m512i odd = _mm512_mul_epi32(_mm512_srli_epi64(a, 32), mm);
+			return _mm512_mask_blend_epi32(0xaaaa, _mm512_srli_epi64(even, 32), odd);
+		}
+
+		template <typename T>
+		inline T divide(T a, divisor const & b)
+		{
+			T q = mulhi(a, b.multiplier) + (((a ^ b.negMask) - b.negMask) & b.addMask);
+			q = q >> b.shift;
+			// Add 1 if negative, to round toward zero
+			return q - ((q >> 31) & b.roundMask);
+		}
+	}
+
+	inline int operator / (int a, divisor const & b)
+		{ return impl::divide(a, b); }
+	inline __m128i operator / (__m128i a, divisor const & b)
+		{ return impl::divide(a, b); }
+	inline __m256i operator / (__m256i a, divisor const & b)
+		{ return impl::divide(a, b); }
+	inline __m512i operator / (__m512i a, divisor const & b)
+		{ return impl::divide(a, b); }
+
+	inline int operator % (int a, divisor const & b)
+		{ return a - (a / b) * b.value; }
+	inline __m128i operator % (__m128i a, divisor const & b)
+		{ return a - (a / b) * b.value; }
+	inline __m256i operator % (__m256i a, divisor const & b)
+		{ return a - (a / b) * b.value; }
+	inline __m512i operator % (__m512i a, divisor const & b)
+		{ return a - (a / b) * b.value; }
+
+	template <typename T, int n>
+	vector<T, n> operator / (vector<T, n> a, divisor const & b)
+	{
+		vector<T, n> result;
+		for (int i = 0; i < n; ++i)
+			result[i] = a[i] / b;
+		return result;
+	}
+	template <typename T, int n>
+	vector<T, n> operator % (vector<T, n> a, divisor const & b)
+	{
+		vector<T, n> result;
+		for (int i = 0; i < n; ++i)
+			result[i] = a[i] % b;
+		return result;
+	}
+
+
+
+	// Hand-vectorized float matrix products.  These overloads take precedence over the generic
+	// templates in util-matrix.h for the common 4-column cases (float4x4/affine3 and float3x4):
+	// each row of the result is a sum of the right-hand matrix's rows, scaled by broadcast
+	// elements of the left-hand row, so a whole row is computed with one multiply-add per term.
+	// Matrices and vectors needn't be aligned.
+
+	namespace impl
+	{
+		// Row vector a times the rows of a 4-column matrix
+		inline __m128 combineRows(const float * a, __m128 b0, __m128 b1, __m128 b2)
+		{
+			__m128 result = _mm_mul_ps(_mm_set1_ps(a[0]), b0);
+			result = fma(_mm_set1_ps(a[1]), b1, result);
+			return fma(_mm_set1_ps(a[2]), b2, result);
+		}
+		inline __m128 combineRows(const float * a, __m128 b0, __m128 b1, __m128 b2, __m128 b3)
+		{
+			return fma(_mm_set1_ps(a[3]), b3, combineRows(a, b0, b1, b2));
+		}
+
+		inline float3 toFloat3(__m128 a)
+		{
+			float3 result;
+			_mm_storel_pi(reinterpret_cast<__m64 *>(&result.x), a);
+			_mm_store_ss(&result.z, _mm_movehl_ps(a, a));
+			return result;
+		}
+	}
+
+	inline float4x4 operator * (float4x4 const & a, float4x4 const & b)
+	{
+		float4x4 result;
+#if defined(__AVX__)
+		// Two rows at a time: each row of b is broadcast to both halves, and the elements of
+		// a pair of rows of a are broadcast within their halves
+		__m256 b0 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&b.data[0]));
+		__m256 b1 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&b.data[4]));
+		__m256 b2 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&b.data[8]));
+		__m256 b3 = _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(&b.data[12]));
+		for (int i = 0; i < 16; i += 8)
+		{
+			__m256 aRows = _mm256_loadu_ps(&a.data[i]);
+			__m256 sum = _mm256_mul_ps(_mm256_permute_ps(aRows, _MM_SHUFFLE(0, 0, 0, 0)), b0);
+			sum = fma(_mm256_permute_ps(aRows, _MM_SHUFFLE(1, 1, 1, 1)), b1, sum);
+			sum = fma(_mm256_permute_ps(aRows, _MM_SHUFFLE(2, 2, 2, 2)), b2, sum);
+			sum = fma(_mm256_permute_ps(aRows, _MM_SHUFFLE(3, 3, 3, 3)), b3, sum);
+			_mm256_storeu_ps(&result.data[i], sum);
+		}
+#else
+		__m128 b0 = _mm_loadu_ps(&b.data[0]);
+		__m128 b1 = _mm_loadu_ps(&b.data[4]);
+		__m128 b2 = _mm_loadu_ps(&b.data[8]);
+		__m128 b3 = _mm_loadu_ps(&b.data[12]);
+		for (int i = 0; i < 16; i += 4)
+			_mm_storeu_ps(&result.data[i], impl::combineRows(&a.data[i], b0, b1, b2, b3));
+#endif
+		return result;
+	}
+
+	inline float3x4 operator * (float3x4 const & a, float4x4 const & b)
+	{
+		__m128 b0 = _mm_loadu_ps(&b.data[0]);
+		__m128 b1 = _mm_loadu_ps(&b.data[4]);
+		__m128 b2 = _mm_loadu_ps(&b.data[8]);
+		__m128 b3 = _mm_loadu_ps(&b.data[12]);
+		float3x4 result;
+		for (int i = 0; i < 12; i += 4)
+			_mm_storeu_ps(&result.data[i], impl::combineRows(&a.data[i], b0, b1, b2, b3));
+		return result;
+	}
+
+	inline float4x4 operator * (float4x3 const & a, float3x4 const & b)
+	{
+		__m128 b0 = _mm_loadu_ps(&b.data[0]);
+		__m128 b1 = _mm_loadu_ps(&b.data[4]);
+		__m128 b2 = _mm_loadu_ps(&b.data[8]);
+		float4x4 result;
+		for (int i = 0; i < 4; ++i)
+			_mm_storeu_ps(&result.data[i*4], impl::combineRows(&a.data[i*3], b0, b1, b2));
+		return result;
+	}
+
+	inline float4 operator * (float4 a, float4x4 const & b)
+	{
+		float4 result;
+		_mm_storeu_ps(&result.x, impl::combineRows(&a.x,
+			_mm_loadu_ps(&b.data[0]), _mm_loadu_ps(&b.data[4]), _mm_loadu_ps(&b.data[8]), _mm_loadu_ps(&b.data[12])));
+		return result;
+	}
+
+	inline float4 operator * (float3 a, float3x4 const & b)
+	{
+		float4 result;
+		_mm_storeu_ps(&result.x, impl::combineRows(&a.x,
+			_mm_loadu_ps(&b.data[0]), _mm_loadu_ps(&b.data[4]), _mm_loadu_ps(&b.data[8])));
+		return result;
+	}
+
+	inline float3 xfmPoint(float3 a, affine3 const & b)
+	{
+		// Start from the translation row, then add the linear part
+		__m128 result = _mm_loadu_ps(&b.data[12]);
+		result = fma(_mm_set1_ps(a.x), _mm_loadu_ps(&b.data[0]), result);
+		result = fma(_mm_set1_ps(a.y), _mm_loadu_ps(&b.data[4]), result);
+		result = fma(_mm_set1_ps(a.z), _mm_loadu_ps(&b.data[8]), result);
+		return impl::toFloat3(result);
+	}
+
+	inline float3 xfmVector(float3 a, affine3 const & b)
+	{
+		return impl::toFloat3(impl::combineRows(&a.x,
+			_mm_loadu_ps(&b.data[0]), _mm_loadu_ps(&b.data[4]), _mm_loadu_ps(&b.data[8])));
+	}
+
+
+
+	// Hand-vectorized float4x4 inverse and determinant.  The matrix is split into 2x2 blocks
+	//   | A B |
+	//   | C D |
+	// and the inverse is built from products of the blocks' adjugates (A# etc.), with each
+	// 2x2 block held in one register in row-major order.  Singularity is tested against
+	// epsilon like the generic versions.  (Eric Zhang, "Fast 4x4 Matrix Inverse with SSE SIMD,
+	// Explained".)
+
+	namespace impl
+	{
+		// 2x2 block products: a*b, a#*b, and a*b#
+		inline __m128 mul2x2(__m128 a, __m128 b)
+		{
+			return _mm_add_ps(
+						_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 3, 0))),
+						_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+		}
+		inline __m128 adjMul2x2(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(
+						_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 3, 3)), b),
+						_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 0, 3, 2))));
+		}
+		inline __m128 mulAdj2x2(__m128 a, __m128 b)
+		{
+			return _mm_sub_ps(
+						_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 3, 0, 3))),
+						_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 2, 1, 2))));
+		}
+
+		// Determinants of the four blocks, (|A|, |B|, |C|, |D|)
+		inline __m128 blockDeterminants(__m128 row0, __m128 row1, __m128 row2, __m128 row3)
+		{
+			return _mm_sub_ps(
+						_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(3, 1, 3, 1))),
+						_mm_mul_ps(_mm_shuffle_ps(row0, row2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(row1, row3, _MM_SHUFFLE(2, 0, 2, 0))));
+		}
+
+		// |M| = |A||D| + |B||C| - tr((A#B)(D#C)), broadcast to all lanes
+		inline __m128 determinantFromBlocks(__m128 detSub, __m128 adjAB, __m128 adjDC)
+		{
+			__m128 detAB = _mm_mul_ps(detSub, _mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 1, 2, 3)));
+			__m128 tr = _mm_mul_ps(adjAB, _mm_shuffle_ps(adjDC, adjDC, _MM_SHUFFLE(3, 1, 2, 0)));
+			tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(2, 3, 0, 1)));
+			tr = _mm_add_ps(tr, _mm_shuffle_ps(tr, tr, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_sub_ps(_mm_add_ps(_mm_shuffle_ps(detAB, detAB, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(detAB, detAB, _MM_SHUFFLE(1, 1, 1, 1))), tr);
+		}
+
+		// Product of the lengths of four rows, for the scale-relative singularity test (see the
+		// generic tryInvertMatrix)
+		inline float rowLengthProduct(__m128 row0, __m128 row1, __m128 row2, __m128 row3)
+		{
+			row0 = _mm_mul_ps(row0, row0);
+			row1 = _mm_mul_ps(row1, row1);
+			row2 = _mm_mul_ps(row2, row2);
+			row3 = _mm_mul_ps(row3, row3);
+			_MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+			__m128 lengths = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(row0, row1), _mm_add_ps(row2, row3)));
+			lengths = _mm_mul_ps(lengths, _mm_shuffle_ps(lengths, lengths, _MM_SHUFFLE(2, 3, 0, 1)));
+			lengths = _mm_mul_ps(lengths, _mm_shuffle_ps(lengths, lengths, _MM_SHUFFLE(1, 0, 3, 2)));
+			return _mm_cvtss_f32(lengths);
+		}
+	}
+
+	inline float determinant(float4x4 const & a, float /*epsilon*/ = util::epsilon)
+	{
+		__m128 row0 = _mm_loadu_ps(&a.data[0]);
+		__m128 row1 = _mm_loadu_ps(&a.data[4]);
+		__m128 row2 = _mm_loadu_ps(&a.data[8]);
+		__m128 row3 = _mm_loadu_ps(&a.data[12]);
+		__m128 blockA = _mm_movelh_ps(row0, row1);
+		__m128 blockB = _mm_movehl_ps(row1, row0);
+		__m128 blockC = _mm_movelh_ps(row2, row3);
+		__m128 blockD = _mm_movehl_ps(row3, row2);
+		__m128 detSub = impl::blockDeterminants(row0, row1, row2, row3);
+		return _mm_cvtss_f32(impl::determinantFromBlocks(detSub, impl::adjMul2x2(blockA, blockB), impl::adjMul2x2(blockD, blockC)));
+	}
+
+	inline bool tryInvertMatrix(float4x4 const & a, float4x4 * pResultOut, float epsilon = util::epsilon)
+	{
+		__m128 row0 = _mm_loadu_ps(&a.data[0]);
+		__m128 row1 = _mm_loadu_ps(&a.data[4]);
+		__m128 row2 = _mm_loadu_ps(&a.data[8]);
+		__m128 row3 = _mm_loadu_ps(&a.data[12]);
+		__m128 blockA = _mm_movelh_ps(row0, row1);
+		__m128 blockB = _mm_movehl_ps(row1, row0);
+		__m128 blockC = _mm_movelh_ps(row2, row3);
+		__m128 blockD = _mm_movehl_ps(row3, row2);
+
+		__m128 detSub = impl::blockDeterminants(row0, row1, row2, row3);
+		__m128 adjAB = impl::adjMul2x2(blockA, blockB);
+		__m128 adjDC = impl::adjMul2x2(blockD, blockC);
+		__m128 det = impl::determinantFromBlocks(detSub, adjAB, adjDC);
+		if (epsilon > 0.0f && abs(_mm_cvtss_f32(det)) <= epsilon * impl::rowLengthProduct(row0, row1, row2, row3))
+			return false;
+		if (!pResultOut)
+			return true;
+
+		// Adjugates of the blocks of the inverse, which is 1/|M| * | X Y |
+		//                                                           | Z W |
+		// X# = |D|A - B(D#C), Y# = |B|C - D(A#B)#, Z# = |C|B - A(D#C)#, W# = |A|D - C(A#B)
+		__m128 adjX = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(3, 3, 3, 3)), blockA), impl::mul2x2(blockB, adjDC));
+		__m128 adjY = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(1, 1, 1, 1)), blockC), impl::mulAdj2x2(blockD, adjAB));
+		__m128 adjZ = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(2, 2, 2, 2)), blockB), impl::mulAdj2x2(blockA, adjDC));
+		__m128 adjW = _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(detSub, detSub, _MM_SHUFFLE(0, 0, 0, 0)), blockD), impl::mul2x2(blockC, adjAB));
+
+		// Undo the adjugates (swap the diagonals and negate the off-diagonals) while scaling
+		// by 1/|M| and shuffling the blocks back into rows
+		__m128 scale = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), det);
+		adjX = _mm_mul_ps(adjX, scale);
+		adjY = _mm_mul_ps(adjY, scale);
+		adjZ = _mm_mul_ps(adjZ, scale);
+		adjW = _mm_mul_ps(adjW, scale);
+		_mm_storeu_ps(&pResultOut->data[0], _mm_shuffle_ps(adjX, adjY, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(&pResultOut->data[4], _mm_shuffle_ps(adjX, adjY, _MM_SHUFFLE(0, 2, 0, 2)));
+		_mm_storeu_ps(&pResultOut->data[8], _mm_shuffle_ps(adjZ, adjW, _MM_SHUFFLE(1, 3, 1, 3)));
+		_mm_storeu_ps(&pResultOut->data[12], _mm_shuffle_ps(adjZ, adjW, _MM_SHUFFLE(0, 2, 0, 2)));
+		return true;
+	}
+
+	inline float4x4 inverse(float4x4 const & a)
+	{
+		float4x4 result;
+		(void) tryInvertMatrix(a, &result, 0.0f);
+		return result;
+	}
+
+
+
+	// Hand-vectorized inverses for affine3 transforms: a 3x3 inverse (or, for inverseRigid, a
+	// transpose) of the linear part, then the translation is transformed by it.  As with the
+	// generic versions, the last column is assumed to be (0, 0, 0, 1), and is ignored.
+
+	namespace impl
+	{
+		// Cross product of the xyz parts; w comes out as zero
+		inline __m128 cross3(__m128 a, __m128 b)
+		{
+			__m128 result = _mm_sub_ps(
+								_mm_mul_ps(a, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 0, 2, 1))),
+								_mm_mul_ps(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 0, 2, 1)), b));
+			return _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1));
+		}
+
+		inline void loadAffineRows(affine3 const & a, __m128 * pRowsOut)
+		{
+			__m128 xyzMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+			pRowsOut[0] = _mm_and_ps(_mm_loadu_ps(&a.data[0]), xyzMask);
+			pRowsOut[1] = _mm_and_ps(_mm_loadu_ps(&a.data[4]), xyzMask);
+			pRowsOut[2] = _mm_and_ps(_mm_loadu_ps(&a.data[8]), xyzMask);
+			pRowsOut[3] = _mm_and_ps(_mm_loadu_ps(&a.data[12]), xyzMask);
+		}
+
+		// Store the inverse transform, given the rows of the inverted linear part (with w = 0)
+		// and the original translation
+		inline void storeAffineInverse(__m128 row0, __m128 row1, __m128 row2, __m128 translation, affine3 * pResultOut)
+		{
+			__m128 t = _mm_mul_ps(_mm_shuffle_ps(translation, translation, _MM_SHUFFLE(0, 0, 0, 0)), row0);
+			t = fma(_mm_shuffle_ps(translation, translation, _MM_SHUFFLE(1, 1, 1, 1)), row1, t);
+			t = fma(_mm_shuffle_ps(translation, translation, _MM_SHUFFLE(2, 2, 2, 2)), row2, t);
+			t = _mm_sub_ps(_mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f), t);
+			_mm_storeu_ps(&pResultOut->data[0], row0);
+			_mm_storeu_ps(&pResultOut->data[4], row1);
+			_mm_storeu_ps(&pResultOut->data[8], row2);
+			_mm_storeu_ps(&pResultOut->data[12], t);
+		}
+	}
+
+	inline bool tryInvertAffine(affine3 const & a, affine3 * pResultOut, float epsilon = util::epsilon)
+	{
+		__m128 rows[4];
+		impl::loadAffineRows(a, rows);
+
+		// Columns of the linear part's inverse are cross products of the rows, over the determinant
+		__m128 col0 = impl::cross3(rows[1], rows[2]);
+		__m128 col1 = impl::cross3(rows[2], rows[0]);
+		__m128 col2 = impl::cross3(rows[0], rows[1]);
+		__m128 det = _mm_mul_ps(rows[0], col0);
+		det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(2, 3, 0, 1)));
+		det = _mm_add_ps(det, _mm_shuffle_ps(det, det, _MM_SHUFFLE(1, 0, 3, 2)));
+		if (epsilon > 0.0f && abs(_mm_cvtss_f32(det)) <= epsilon * impl::rowLengthProduct(rows[0], rows[1], rows[2], _mm_set_ss(1.0f)))
+			return false;
+		if (!pResultOut)
+			return true;
+
+		__m128 scale = _mm_div_ps(_mm_set1_ps(1.0f), det);
+		col0 = _mm_mul_ps(col0, scale);
+		col1 = _mm_mul_ps(col1, scale);
+		col2 = _mm_mul_ps(col2, scale);
+		__m128 col3 = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(col0, col1, col2, col3);
+		impl::storeAffineInverse(col0, col1, col2, rows[3], pResultOut);
+		return true;
+	}
+
+	inline affine3 inverseAffine(affine3 const & a)
+	{
+		affine3 result;
+		(void) tryInvertAffine(a, &result, 0.0f);
+		return result;
+	}
+
+	inline affine3 inverseRigid(affine3 const & a)
+	{
+		__m128 rows[4];
+		impl::loadAffineRows(a, rows);
+		__m128 zero = _mm_setzero_ps();
+		_MM_TRANSPOSE4_PS(rows[0], rows[1], rows[2], zero);
+		affine3 result;
+		impl::storeAffineInverse(rows[0], rows[1], rows[2], rows[3], &result);
+		return result;
+	}
+
+
+
+	// Lane-parallel 4x4 inverses, for matrices of SIMD lanes (i.e. a separate matrix in each
+	// lane).  Instead of a bool, these return a lane mask of which matrices were invertible,
+	// i.e. had abs(det) > epsilon times the product of the row lengths, as in the generic
+	// tryInvertMatrix; the others come out as zero.  There are no branches, so this
+	// is a throughput path for inverting many matrices at once (see also inverseBatch()).
+
+	namespace impl
+	{
+		template <typename T>
+		inline auto tryInvertLanes(matrix<T, 4, 4> const & a, matrix<T, 4, 4> * pResultOut, float epsilon)
+			-> decltype(a[0][0] >= a[0][0])
+		{
+			T det;
+			matrix<T, 4, 4> adj = adjugate(a, &det);
+			T scale = length(a[0]) * length(a[1]) * length(a[2]) * length(a[3]);
+			auto invertible = (abs(det) > splat<T>(epsilon) * scale);
+			if (pResultOut)
+				*pResultOut = adj * select(invertible, splat<T>(1.0f) / det, splat<T>(0.0f));
+			return invertible;
+		}
+	}
+
+	inline __m128 tryInvertMatrix(matrix<__m128, 4, 4> const & a, matrix<__m128, 4, 4> * pResultOut, float epsilon = util::epsilon)
+		{ return impl::tryInvertLanes(a, pResultOut, epsilon); }
+	inline __m256 tryInvertMatrix(matrix<__m256, 4, 4> const & a, matrix<__m256, 4, 4> * pResultOut, float epsilon = util::epsilon)
+		{ return impl::tryInvertLanes(a, pResultOut, epsilon); }
+	inline __mmask16 tryInvertMatrix(matrix<__m512, 4, 4> const & a, matrix<__m512, 4, 4> * pResultOut, float epsilon = util::epsilon)
+		{ return impl::tryInvertLanes(a, pResultOut, epsilon); }
+
+
+
+	// Runtime CPU feature detection and dispatch
+
+	// The operators above are resolved at compile time, so they use whatever instruction set
+	// the including code is built for.  Out-of-line kernels (like convertToAOSOA below) instead
+	// have an implementation per ISA level, and pick the best one the CPU supports at runtime,
+	// so a single binary can run on any x64 machine.
+
+	enum ISA		// Instruction Set Architecture level
+	{
+		ISA_SSE2,
+		ISA_AVX2,		// AVX2 + FMA3
+		ISA_AVX512,		// AVX-512 Foundation
+
+		ISA_Count
+	};
+
+	// Highest ISA level supported by both the CPU and the OS (checked via cpuid/xgetbv).
+	// Computed on first call and cached.
+	ISA detectISA();
+
+	// ISA level the dispatched kernels are currently using.
+	ISA currentISA();
+
+	// Force the kernels to a specific ISA level, e.g. for benchmarking or testing the
+	// narrower code paths.  Levels above detectISA() are clamped, with a warning.
+	// Pass ISA_Count to go back to using the detected level.
+	void forceISA(ISA isa);
+
+	const char * nameOfISA(ISA isa);
+
+
+
+	// Convert memory layouts to and from SIMD-friendly AOSOA layout
+
+	// convertToAOSOA takes a layout like this:
+	//   xyz...xyz...xyz...xyz...
+	// and makes it look like this:
+	//   xxxxyyyyzzzz...xxxxyyyyzzzz...
+	// In other words, it groups vectors in chunks, and stores each chunk in SOA layout.
+	// Components (xyz) are always assumed to be 32 bits each (float or int).
+    // Both input and output layouts can have an arbitrary stride, but the components of each
+	// individual vector are assumed to be tightly packed.
+	// numComponents is the count of components per vector (e.g. 3 for xyz, 4 for xyzw).
+	// numVectors is the count of vectors (each xyz or xyzw).  If this is not a multiple of the,
+	// chunk size, the last chunk in the output array will be zero-padded to fill it out.
+	// vectorsPerChunk is the number of vectors per chunk. Usually 4 for SSE, 8 for AVX.
+	// The common cases of 2-4 components and 4, 8, or 16 vectors per chunk are transposed in
+	// SIMD registers; other cases fall back to a slower generic loop.
+	// mode selects whether the output is written through the cache or streamed straight to
+	// memory with non-temporal stores (and the input prefetched ahead).  Streaming is a win for
+	// outputs much larger than the last-level cache, which won't be read again soon anyway.
+
+	enum AOSOAM		// AOSOA conversion Mode
+	{
+		AOSOAM_Auto,		// Streaming if the output is at least g_aosoaStreamingThresholdBytes
+		AOSOAM_Cached,
+		AOSOAM_Streaming,
+	};
+
+	extern size_t g_aosoaStreamingThresholdBytes;
+
+	void convertToAOSOA(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk = 4,
+		AOSOAM mode = AOSOAM_Auto);
+
+	// convertFromAOSOA does the inverse of convertToAOSOA.
+
+	void convertFromAOSOA(
+		int numComponents,
+		int numVectors,
+		const void * pInput,
+		int inputStrideBytes,
+		void * pOutput,
+		int outputStrideBytes,
+		int vectorsPerChunk = 4);
+
+
+
+	// Typedefs of SIMD vectors, matrices, points, and affines,
+	// for the most common types and dimensions
+	typedef vector<__m128, 2> float2_simd;
+	typedef vector<__m128, 3> float3_simd;
+	typedef vector<__m128, 4> float4_simd;
+	typedef vector<__m128i, 2> int2_simd;
+	typedef vector<__m128i, 3> int3_simd;
+	typedef vector<__m128i, 4> int4_simd;
+	typedef matrix<__m128, 2, 2> float2x2_simd;
+	typedef matrix<__m128, 3, 3> float3x3_simd;
+	typedef matrix<__m128, 3, 4> float3x4_simd;
+	typedef matrix<__m128, 4, 3> float4x3_simd;
+	typedef matrix<__m128, 4, 4> float4x4_simd;
+	typedef matrix<__m128i, 2, 2> int2x2_simd;
+	typedef matrix<__m128i, 3, 3> int3x3_simd;
+	typedef matrix<__m128i, 3, 4> int3x4_simd;
+	typedef matrix<__m128i, 4, 3> int4x3_simd;
+	typedef matrix<__m128i, 4, 4> int4x4_simd;
+
+	// 8-wide versions, for AVX/AVX2
+	typedef vector<__m256, 2> float2_simd8;
+	typedef vector<__m256, 3> float3_simd8;
+	typedef vector<__m256, 4> float4_simd8;
+	typedef vector<__m256i, 2> int2_simd8;
+	typedef vector<__m256i, 3> int3_simd8;
+	typedef vector<__m256i, 4> int4_simd8;
+	typedef matrix<__m256, 2, 2> float2x2_simd8;
+	typedef matrix<__m256, 3, 3> float3x3_simd8;
+	typedef matrix<__m256, 3, 4> float3x4_simd8;
+	typedef matrix<__m256, 4, 3> float4x3_simd8;
+	typedef matrix<__m256, 4, 4> float4x4_simd8;
+	typedef matrix<__m256i, 2, 2> int2x2_simd8;
+	typedef matrix<__m256i, 3, 3> int3x3_simd8;
+	typedef matrix<__m256i, 3, 4> int3x4_simd8;
+	typedef matrix<__m256i, 4, 3> int4x3_simd8;
+	typedef matrix<__m256i, 4, 4> int4x4_simd8;
+
+	// 16-wide versions, for AVX-512
+	typedef vector<__m512, 2> float2_simd16;
+	typedef vector<__m512, 3> float3_simd16;
+	typedef vector<__m512, 4> float4_simd16;
+	typedef vector<__m512i, 2> int2_simd16;
+	typedef vector<__m512i, 3> int3_simd16;
+	typedef vector<__m512i, 4> int4_simd16;
+	typedef matrix<__m512, 2, 2> float2x2_simd16;
+	typedef matrix<__m512, 3, 3> float3x3_simd16;
+	typedef matrix<__m512, 3, 4> float3x4_simd16;
+	typedef matrix<__m512, 4, 3> float4x3_simd16;
+	typedef matrix<__m512, 4, 4> float4x4_simd16;
+	typedef matrix<__m512i, 2, 2> int2x2_simd16;
+	typedef matrix<__m512i, 3, 3> int3x3_simd16;
+	typedef matrix<__m512i, 3, 4> int3x4_simd16;
+	typedef matrix<__m512i, 4, 3> int4x3_simd16;
+	typedef matrix<__m512i, 4, 4> int4x4_simd16;
+
+	// Map a scalar type and lane count to the SIMD type that holds that many of them
+	template <typename T, int W> struct simd_lane;
+	template <> struct simd_lane<float, 4> { typedef __m128 type; };
+	template <> struct simd_lane<float, 8> { typedef __m256 type; };
+	template <> struct simd_lane<float, 16> { typedef __m512 type; };
+	template <> struct simd_lane<int, 4> { typedef __m128i type; };
+	template <> struct simd_lane<int, 8> { typedef __m256i type; };
+	template <> struct simd_lane<int, 16> { typedef __m512i type; };
 
-	// Typedefs of SIMD vectors, matrices, points, and affines,
-	// for the most common types and dimensions
-	typedef vector<__m128, 2> float2_simd;
-	typedef vector<__m128, 3> float3_simd;
-	typedef vector<__m128, 4> float4_simd;
-	typedef vector<__m128i, 2> int2_simd;
-	typedef vector<__m128i, 3> int3_simd;
-	typedef vector<__m128i, 4> int4_simd;
-	typedef matrix<__m128, 2, 2> float2x2_simd;
-	typedef matrix<__m128, 3, 3> float3x3_simd;
-	typedef matrix<__m128, 3, 4> float3x4_simd;
-	typedef matrix<__m128, 4, 3> float4x3_simd;
-	typedef matrix<__m128, 4, 4> float4x4_simd;
-	typedef matrix<__m128i, 2, 2> int2x2_simd;
-	typedef matrix<__m128i, 3, 3> int3x3_simd;
-	typedef matrix<__m128i, 3, 4> int3x4_simd;
-	typedef matrix<__m128i, 4, 3> int4x3_simd;
-	typedef matrix<__m128i, 4, 4> int4x4_simd;
 }
@@ -7,11 +7,13 @@ namespace util
 	// Mixin macro for vector members common to all specializations
 #define MIXIN_VECTOR_MEMBERS(n)																\
 			/* Subscript accessors */														\
-			      T & operator [] (int i)       { return data[i]; }							\
-			const T & operator [] (int i) const { return data[i]; }							\
-			/* Constructors */																\
+			constexpr       T & operator [] (int i)       { return data[i]; }				\
+			constexpr const T & operator [] (int i) const { return data[i]; }				\
+			/* Constructors.  All but the default one are constexpr, so vectors can be		\
+			   built at compile time; they initialize the data array, since that's the		\
+			   union member constant expressions can access. */								\
 			vector() {}																		\
-			vector(std::initializer_list<T> initList)										\
+			constexpr vector(std::initializer_list<T> initList): data()						\
 			{																				\
 				int m = min(n, int(initList.size()));										\
 				auto iter = initList.begin();												\
@@ -24,19 +26,19 @@ namespace util
 				for (int i = m; i < n; ++i)													\
 					data[i] = T(0);															\
 			}																				\
-			explicit vector(T a)															\
+			constexpr explicit vector(T a): data()											\
 			{																				\
 				for (int i = 0; i < n; ++i)													\
 					data[i] = a;															\
 			}																				\
 			template <typename U>															\
-			explicit vector(const U * p)													\
+			constexpr explicit vector(const U * p): data()									\
 			{																				\
 				for (int i = 0; i < n; ++i)													\
 					data[i] = T(p[i]);														\
 			}																				\
 			template <typename U, int nOther>												\
-			explicit vector(vector<U, nOther> v)											\
+			constexpr explicit vector(vector<U, nOther> v): data()							\
 			{																				\
 				int m = min(n, int(nOther));												\
 				for (int i = 0; i < m; ++i)													\
@@ -77,7 +79,7 @@ namespace util
 			struct { T u, v; };
 		};
 		MIXIN_VECTOR_MEMBERS(2);
-		vector(T x_, T y_) { x = x_; y = y_; }
+		constexpr vector(T x_, T y_): data{x_, y_} {}
 	};
 
 	template <typename T>
@@ -92,8 +94,8 @@ namespace util
 			struct { vector<T, 2> uv; };
 		};
 		MIXIN_VECTOR_MEMBERS(3);
-		vector(T x_, T y_, T z_) { x = x_; y = y_; z = z_; }
-		vector(vector<T, 2> xy_, T z_) { xy = xy_; z = z_; }
+		constexpr vector(T x_, T y_, T z_): data{x_, y_, z_} {}
+		constexpr vector(vector<T, 2> xy_, T z_): data{xy_[0], xy_[1], z_} {}
 	};
 
 	template <typename T>
@@ -110,9 +112,9 @@ namespace util
 			struct { vector<T, 3> rgb; };
 		};
 		MIXIN_VECTOR_MEMBERS(4);
-		vector(T x_, T y_, T z_, T w_) { x = x_; y = y_; z = z_; w = w_; }
-		vector(vector<T, 2> xy_, T z_, T w_) { xy = xy_; z = z_; w = w_; }
-		vector(vector<T, 3> xyz_, T w_) { xyz = xyz_; w = w_; }
+		constexpr vector(T x_, T y_, T z_, T w_): data{x_, y_, z_, w_} {}
+		constexpr vector(vector<T, 2> xy_, T z_, T w_): data{xy_[0], xy_[1], z_, w_} {}
+		constexpr vector(vector<T, 3> xyz_, T w_): data{xyz_[0], xyz_[1], xyz_[2], w_} {}
 	};
 
 #pragma warning(pop)
@@ -142,49 +144,48 @@ namespace util
 
 	// Overloaded math operators
 
+	// These are constexpr, and work on their by-value arguments in place, as constant
+	// expressions can't use a default-constructed (uninitialized) result.
+
 #define DEFINE_UNARY_OPERATOR(op) \
 			template <typename T, int n> \
-			vector<T, n> operator op (vector<T, n> a) \
+			constexpr vector<T, n> operator op (vector<T, n> a) \
 			{ \
-				vector<T, n> result; \
 				for (int i = 0; i < n; ++i) \
-					result[i] = op a[i]; \
-				return result; \
+					a[i] = op a[i]; \
+				return a; \
 			}
 
 #define DEFINE_BINARY_OPERATORS(op) \
 			/* Vector-vector op */ \
 			template <typename T, int n> \
-			vector<T, n> operator op (vector<T, n> a, vector<T, n> b) \
+			constexpr vector<T, n> operator op (vector<T, n> a, vector<T, n> b) \
 			{ \
-				vector<T, n> result; \
 				for (int i = 0; i < n; ++i) \
-					result[i] = a[i] op b[i]; \
-				return result; \
+					a[i] = a[i] op b[i]; \
+				return a; \
 			} \
 			/* Scalar-vector op */ \
 			template <typename T, int n> \
-			vector<T, n> operator op (T a, vector<T, n> b) \
+			constexpr vector<T, n> operator op (T a, vector<T, n> b) \
 			{ \
-				vector<T, n> result; \
 				for (int i = 0; i < n; ++i) \
-					result[i] = a op b[i]; \
-				return result; \
+					b[i] = a op b[i]; \
+				return b; \
 			} \
 			/* Vector-scalar op */ \
 			template <typename T, int n> \
-			vector<T, n> operator op (vector<T, n> a, T b) \
+			constexpr vector<T, n> operator op (vector<T, n> a, T b) \
 			{ \
-				vector<T, n> result; \
 				for (int i = 0; i < n; ++i) \
-					result[i] = a[i] op b; \
-				return result; \
+					a[i] = a[i] op b; \
+				return a; \
 			}
 
 #define DEFINE_INPLACE_OPERATORS(op) \
 			/* Vector-vector op */ \
 			template <typename T, int n> \
-			vector<T, n> & operator op (vector<T, n> & a, vector<T, n> b) \
+			constexpr vector<T, n> & operator op (vector<T, n> & a, vector<T, n> b) \
 			{ \
 				for (int i = 0; i < n; ++i) \
 					a[i] op b[i]; \
@@ -192,37 +193,39 @@ namespace util
 			} \
 			/* Vector-scalar op */ \
 			template <typename T, int n> \
-			vector<T, n> & operator op (vector<T, n> & a, T b) \
+			constexpr vector<T, n> & operator op (vector<T, n> & a, T b) \
 			{ \
 				for (int i = 0; i < n; ++i) \
 					a[i] op b; \
 				return a; \
 			}
 
+	// Relational ops return a vector of whatever the element comparison returns -
+	// bool for scalar types, or a mask type for SIMD types (e.g. __m128, __mmask16)
 #define DEFINE_RELATIONAL_OPERATORS(op) \
 			/* Vector-vector op */ \
 			template <typename T, typename U, int n> \
-			vector<bool, n> operator op (vector<T, n> a, vector<U, n> b) \
+			vector<decltype(T() op U()), n> operator op (vector<T, n> a, vector<U, n> b) \
 			{ \
-				vector<bool, n> result; \
+				vector<decltype(T() op U()), n> result; \
 				for (int i = 0; i < n; ++i) \
 					result[i] = a[i] op b[i]; \
 				return result; \
 			} \
 			/* Scalar-vector op */ \
 			template <typename T, typename U, int n> \
-			vector<bool, n> operator op (T a, vector<U, n> b) \
+			vector<decltype(T() op U()), n> operator op (T a, vector<U, n> b) \
 			{ \
-				vector<bool, n> result; \
+				vector<decltype(T() op U()), n> result; \
 				for (int i = 0; i < n; ++i) \
 					result[i] = a op b[i]; \
 				return result; \
 			} \
 			/* Vector-scalar op */ \
 			template <typename T, typename U, int n> \
-			vector<bool, n> operator op (vector<T, n> a, U b) \
+			vector<decltype(T() op U()), n> operator op (vector<T, n> a, U b) \
 			{ \
-				vector<bool, n> result; \
+				vector<decltype(T() op U()), n> result; \
 				for (int i = 0; i < n; ++i) \
 					result[i] = a[i] op b; \
 				return result; \
@@ -263,11 +266,32 @@ namespace util
 
 	// Other math functions
 
+	// Componentwise fma, with a vector or scalar as the second factor
 	template <typename T, int n>
-	T dot(vector<T, n> a, vector<T, n> b)
+	vector<T, n> fma(vector<T, n> a, vector<T, n> b, vector<T, n> c)
 	{
-		T result(0);
+		vector<T, n> result;
 		for (int i = 0; i < n; ++i)
+			result[i] = fma(a[i], b[i], c[i]);
+		return result;
+	}
+	template <typename T, int n>
+	vector<T, n> fma(vector<T, n> a, T b, vector<T, n> c)
+	{
+		vector<T, n> result;
+		for (int i = 0; i < n; ++i)
+			result[i] = fma(a[i], b, c[i]);
+		return result;
+	}
+
+	// Note: dot is a plain multiply-add so it can be constexpr; util-simd.h overloads it
+	// for the SIMD lane types to accumulate with fma.
+	template <typename T, int n>
+	constexpr T dot(vector<T, n> a, vector<T, n> b)
+	{
+		// Note: start from the first term rather than T(0), so this works for SIMD types too
+		T result = a[0] * b[0];
+		for (int i = 1; i < n; ++i)
 			result += a[i] * b[i];
 		return result;
 	}
@@ -289,7 +313,7 @@ namespace util
 	{
 		vector<T, n> result;
 		for (int i = 0; i < n; ++i)
-			result[i] = ::pow(a[i], p);
+			result[i] = pow(a[i], p);
 		return result;
 	}
 
@@ -337,13 +361,13 @@ namespace util
 	}
 
 	template <typename T>
-	vector<T, 3> cross(vector<T, 3> a, vector<T, 3> b)
+	constexpr vector<T, 3> cross(vector<T, 3> a, vector<T, 3> b)
 	{
-		return {
-			a.y*b.z - a.z*b.y,
-			a.z*b.x - a.x*b.z,
-			a.x*b.y - a.y*b.x,
-		};
+		// Note: subscripts rather than .x/.y/.z, so this works in constant expressions
+		return vector<T, 3>(
+			a[1]*b[2] - a[2]*b[1],
+			a[2]*b[0] - a[0]*b[2],
+			a[0]*b[1] - a[1]*b[0]);
 	}
 
 	template <typename T>
@@ -372,51 +396,53 @@ namespace util
 
 
 
-	// Utilities for bool vectors
+	// Utilities for bool vectors.  These also work for vectors of SIMD masks (as returned by
+	// comparing SIMD vectors), in which case they operate per-lane, given overloads of
+	// select() for the mask and lane types.
 
 	// Any: checks if any of the values of a bool vector is true, i.e. ORs them together.
-	template <int n>
-	bool any(vector<bool, n> a)
+	template <typename M, int n>
+	M any(vector<M, n> a)
 	{
-		bool result = a[0];
+		M result = a[0];
 		for (int i = 1; i < n; ++i)
 			result |= a[i];
 		return result;
 	}
 
 	// All: checks if all of the values of a bool vector are true, i.e. ANDs them together.
-	template <int n>
-	bool all(vector<bool, n> a)
+	template <typename M, int n>
+	M all(vector<M, n> a)
 	{
-		bool result = a[0];
+		M result = a[0];
 		for (int i = 1; i < n; ++i)
 			result &= a[i];
 		return result;
 	}
 
 	// Select: ternary operator for vectors. Selects componentwise from a or b based on cond.
-	template <typename T, int n>
-	vector<T, n> select(vector<bool, n> cond, vector<T, n> a, vector<T, n> b)
+	template <typename M, typename T, int n>
+	vector<T, n> select(vector<M, n> cond, vector<T, n> a, vector<T, n> b)
 	{
 		vector<T, n> result;
 		for (int i = 0; i < n; ++i)
-			result[i] = cond[i] ? a[i] : b[i];
+			result[i] = select(cond[i], a[i], b[i]);
 		return result;
 	}
-	template <typename T, int n>
-	vector<T, n> select(vector<bool, n> cond, T a, vector<T, n> b)
+	template <typename M, typename T, int n>
+	vector<T, n> select(vector<M, n> cond, T a, vector<T, n> b)
 	{
 		vector<T, n> result;
 		for (int i = 0; i < n; ++i)
-			result[i] = cond[i] ? a : b[i];
+			result[i] = select(cond[i], a, b[i]);
 		return result;
 	}
-	template <typename T, int n>
-	vector<T, n> select(vector<bool, n> cond, vector<T, n> a, T b)
+	template <typename M, typename T, int n>
+	vector<T, n> select(vector<M, n> cond, vector<T, n> a, T b)
 	{
 		vector<T, n> result;
 		for (int i = 0; i < n; ++i)
-			result[i] = cond[i] ? a[i] : b;
+			result[i] = select(cond[i], a[i], b);
 		return result;
 	}
 
@@ -442,7 +468,12 @@ namespace util
 
 	template <typename T, int n>
 	vector<T, n> abs(vector<T, n> a)
-		{ return select(a < T(0), -a, a); }
+	{
+		vector<T, n> result;
+		for (int i = 0; i < n; ++i)
+			result[i] = abs(a[i]);
+		return result;
+	}
 
 	template <typename T, int n>
 	vector<T, n> clamp(vector<T, n> value, T lower, T upper)
@@ -450,7 +481,7 @@ namespace util
 
 	template <typename T, int n>
 	vector<T, n> saturate(vector<T, n> value)
-		{ return clamp(value, T(0), T(1)); }
+		{ return clamp(value, splat<T>(0.0f), splat<T>(1.0f)); }
 
 	template <typename T, int n>
 	T minComponent(vector<T, n> a)